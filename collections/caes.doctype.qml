@@ -11,6 +11,8 @@ Collection {
         parent: "bill"
 
         infoFormat: "Facture CAES du %{date%date:dd/MM/yyyy}, %{amount%A}"
+
+        keywords: [ "CAES DU CNRS" ]
         
         function isMine(pdf) {
             if(pdf["text"].match(/CAES DU CNRS/)) {
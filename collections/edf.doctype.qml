@@ -11,6 +11,8 @@ Collection {
         parent: "bill"
 
         infoFormat: "Facture EDF du %{date%date:dd/MM/yyyy}, %{amount%A}"
+
+        patterns: [ "\\.edf\\.(com|fr)" ]
         
         function isMine(pdf) {
             if(pdf["text"].match(/\.edf\.(com|fr)/)) {
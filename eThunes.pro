@@ -10,7 +10,7 @@ DEPENDPATH += src
 
 VERSION = 0.0
 
-QT += xml network
+QT += xml network concurrent
 
 # QT5:
 QT +=  widgets
@@ -36,6 +36,13 @@ sanitizer {
   TARGET = $$join(TARGET,,,-snt)
 }
 
+# Count the Watchdog objects and their connections, for the
+# --query-connections command-line option, by passing a
+# CONFIG+=watchdog_statistics argument to qmake
+watchdog_statistics {
+  DEFINES += WATCHDOG_STATISTICS
+}
+
 
 # Really, this should be the default, since it means segfault in the
 # best case
@@ -95,7 +102,16 @@ SOURCES += src/qmain.cc src/account.cc src/mainwin.cc src/actions.cc \
         src/documentwidget.cc \
         src/attributehashwidget.cc \
         src/xmlreader.cc \
-        src/budgetdw.cc
+        src/budgetdw.cc \
+        src/categorizationindex.cc \
+        src/aggregatecube.cc \
+        src/transactioncursor.cc \
+        src/documentingestion.cc \
+        src/documentmatcher.cc \
+        src/textindex.cc \
+        src/documentscanner.cc \
+        src/fetchscheduler.cc \
+        src/filestamp.cc
 
 HEADERS += src/account.hh src/mainwin.hh src/actions.hh \
            src/ofximport.hh src/accountmodel.hh \
@@ -152,7 +168,18 @@ HEADERS += src/account.hh src/mainwin.hh src/actions.hh \
            src/documentwidget.hh \
            src/attributehashwidget.hh \
            src/xmlreader.hh \
-           src/budgetdw.hh
+           src/budgetdw.hh \
+           src/categorizationindex.hh \
+           src/aggregatecube.hh \
+           src/transactioncursor.hh \
+           src/documentingestion.hh \
+           src/documentmatcher.hh \
+           src/textindex.hh \
+           src/documentscanner.hh \
+           src/boundedqueue.hh \
+           src/amountkernels.hh \
+           src/fetchscheduler.hh \
+           src/filestamp.hh
 
 
 
@@ -35,7 +35,8 @@ CarEvent::CarEvent() :
   fullTank(false),
   pricePerLiter(-1),
   interpolatedKilometers(-1),
-  consumption(-1)
+  consumption(-1),
+  defaultPrice(-1)
 {
 }
 
@@ -96,9 +97,7 @@ int CarEvent::fuelPrice(bool * computed) const
   *computed = true;
   if(fuel >= 0)
     return amount()*100/fuel;
-  if(plugin)
-    return plugin->car.defaultPricePerLiter[date()];
-  return -1;
+  return defaultPrice;
 }
 
 int CarEvent::fuelLiters(bool * computed) const
@@ -111,11 +110,8 @@ int CarEvent::fuelLiters(bool * computed) const
   *computed = true;
   if(pricePerLiter >= 0)
     return amount()*100/pricePerLiter;
-  if(plugin) {
-    int price = plugin->car.defaultPricePerLiter[date()];
-    if(price > 0)
-      return amount()*100/price;
-  }
+  if(defaultPrice > 0)
+    return amount()*100/defaultPrice;
   return -1;
 }
 
@@ -196,6 +192,24 @@ void Car::updateCache()
   bool dummy;
 
   lastTaggedEvent.clear();
+
+  // The events are not necessarily sorted by date, so the default
+  // prices are looked up in date order, in a single pass.
+  QVector<QDate> dates(events.size());
+  QVector<int> order(events.size());
+  for(int i = 0; i < events.size(); i++) {
+    dates[i] = events[i].date();
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&dates](int a, int b) -> bool {
+      return dates[a] < dates[b];
+    });
+  QList<QDate> sortedDates;
+  for(int i : order)
+    sortedDates << dates[i];
+  QVector<int> prices = defaultPricePerLiter.valuesAt(sortedDates);
+  for(int i = 0; i < order.size(); i++)
+    events[order[i]].defaultPrice = prices[i];
   
   for(int i = 0; i < events.size(); i++) {
     events[i].plugin = plugin;
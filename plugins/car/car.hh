@@ -94,6 +94,9 @@ public:
   /// The calculated consumption, or -1 if not computable
   int consumption;
 
+  /// The Car::defaultPricePerLiter at the date of the event
+  int defaultPrice;
+
   int kmSinceFull;
 
   int litersSinceFull;
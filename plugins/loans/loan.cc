@@ -243,7 +243,7 @@ void Loan::findMatchingTransactions()
   Period p;
   p.endDate = QDate::currentDate();
   p.startDate = dateContracted;
-  TransactionPtrList transactions = 
+  TransactionVector transactions = 
     targetPlugin->cabinet->wallet.
     transactionsForPeriod(p);
 
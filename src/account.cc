@@ -19,8 +19,11 @@
 #include <headers.hh>
 #include <account.hh>
 #include <wallet.hh>		// For filtering
+#include <transactioncursor.hh>
+#include <periodic.hh>
 
-Account::Account() : wallet(NULL) 
+Account::Account() : dateIndexValid(false), dateIndexSorted(false),
+                     wallet(NULL)
 {
   watchChild(&transactions, "transactions");
 }
@@ -54,6 +57,7 @@ int Account::importTransactions(TransactionList t, Wallet * filters)
   // Now, we sort and update the balance
   transactions.sortByDate();
   transactions.computeBalance();
+  invalidateDateIndex();
 
   return t.size();
 }
@@ -74,20 +78,61 @@ void Account::sanitizeAccount()
 {
   transactions.sanitizeList(this);
   transactions.computeBalance();
+  invalidateDateIndex();
 }
 
 void Account::clearContents()
 {
   transactions.clear();
+  invalidateDateIndex();
+}
+
+void Account::ensureDateIndex() const
+{
+  // The size check catches modifications of the list that did not
+  // invalidate the index.
+  if(dateIndexValid && dateIndex.size() == transactions.size())
+    return;
+  dateIndex.resize(transactions.size());
+  dateIndexSorted = true;
+  for(int i = 0; i < transactions.size(); i++) {
+    dateIndex[i] = transactions.at(i).getDate().toJulianDay();
+    if(i > 0 && dateIndex[i] < dateIndex[i-1])
+      dateIndexSorted = false;
+  }
+  dateIndexValid = true;
+}
+
+bool Account::transactionRange(const Period & period, int * first,
+                               int * last) const
+{
+  ensureDateIndex();
+  if(! dateIndexSorted)
+    return false;
+  QVector<qint64>::const_iterator b =
+    std::lower_bound(dateIndex.constBegin(), dateIndex.constEnd(),
+                     period.startDate.toJulianDay());
+  QVector<qint64>::const_iterator e =
+    std::upper_bound(b, dateIndex.constEnd(),
+                     period.endDate.toJulianDay());
+  *first = b - dateIndex.constBegin();
+  *last = e - dateIndex.constBegin();
+  return true;
+}
+
+TransactionVector Account::transactionsForPeriod(const Period & period)
+{
+  int first, last;
+  if(transactionRange(period, &first, &last))
+    return AccountCursor(this, first, last).toVector();
+  return AccountCursor(this, [&period](const AtomicTransaction * t) {
+      return period.contains(t->getDate());
+    }).toVector();
 }
 
 TransactionPtrList Account::allTransactions()
 {
-  /// @todo This should be rewritten using iterators !
-  TransactionPtrList ret;
-  for(int i = 0; i < transactions.size(); i++)
-    ret.append(transactions[i].allSubTransactions());
-  return ret;
+  return AccountCursor(this).toPtrList();
 }
 
 
@@ -95,10 +140,16 @@ TransactionPtrList Account::categoryTransactions(const Category * category,
                                                  bool parents)
 {
   TransactionPtrList found;
-  /// @todo Rewrite using iterators when available !
-  TransactionPtrList all = allTransactions();
-  for(int i = 0; i < all.size(); i++) {
-    AtomicTransaction * t = all[i];
+  if(wallet) {
+    TransactionVector lst =
+      wallet->categorizationIndex.categoryTransactions(category, parents);
+    for(int i = 0; i < lst.size(); i++)
+      if(lst[i]->getAccount() == this)
+        found << lst[i];
+    return found;
+  }
+
+  for(AtomicTransaction * t : AccountCursor(this)) {
     if(t->getCategory() == category || 
        (parents && t->getCategory() && 
         t->getCategory()->isChildOf(category))
@@ -111,10 +162,16 @@ TransactionPtrList Account::categoryTransactions(const Category * category,
 TransactionPtrList Account::taggedTransactions(const Tag * tag)
 {
   TransactionPtrList lst;
-  /// @todo Rewrite using iterators when available !
-  TransactionPtrList all = allTransactions();
-  for(int i = 0; i < all.size(); i++) {
-    AtomicTransaction * t = all[i];
+  if(wallet) {
+    TransactionVector all =
+      wallet->categorizationIndex.taggedTransactions(tag);
+    for(int i = 0; i < all.size(); i++)
+      if(all[i]->getAccount() == this)
+        lst << all[i];
+    return lst;
+  }
+
+  for(AtomicTransaction * t : AccountCursor(this)) {
     if(t->hasTag(tag))
       lst.append(t);
   }
@@ -171,13 +228,9 @@ Transaction * Account::namedTransaction(const QString & name)
 
 int Account::balance(const QDate & date) const
 {
-
-  QList<QDate> mirror;          /// @todo bad, but, well...  Maybe
-                                /// with a cache it would be nice ?
-  for(int i = 0; i < transactions.size(); i++)
-    mirror << transactions[i].getDate();
-
-  int which =  qUpperBound(mirror, date) - mirror.begin();
+  ensureDateIndex();
+  int which = std::upper_bound(dateIndex.constBegin(), dateIndex.constEnd(),
+                               date.toJulianDay()) - dateIndex.constBegin();
   if(!which)
     return 0;
   else {
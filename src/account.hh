@@ -27,12 +27,30 @@
 #include <filter.hh>
 #include <httarget.hh>
 
+class Period;
+
 /// Represents informations about an account.
 ///
 /// \todo Maybe this class and all the other ones should join a Money
 /// namespace of some kind when the program sees the birth of the new
 /// functionalities ?
 class Account : public Serializable, public HTTarget {
+
+  /// The julian day of each Transaction in transactions, for the
+  /// date-based lookups. Built lazily by ensureDateIndex().
+  mutable QVector<qint64> dateIndex;
+
+  /// Whether dateIndex is up-to-date.
+  mutable bool dateIndexValid;
+
+  /// Whether the transactions are actually sorted by date, which may
+  /// not be the case after the date of a Transaction was changed. The
+  /// lookups fall back to a linear scan in that case.
+  mutable bool dateIndexSorted;
+
+  /// Makes sure dateIndex is up-to-date
+  void ensureDateIndex() const;
+
 public:
 
   /// \name Bank-given attributes
@@ -144,11 +162,29 @@ public:
                                           bool parents = true);
 
 
-  /// This returns all the atomic transactions. This just returns a
-  /// sum of Transaction::allSubTransactions. Probably, the best way
-  /// here would be to use iterators
+  /// This returns all the atomic transactions. Use an AccountCursor
+  /// to go through them without building a list.
   TransactionPtrList allTransactions();
 
+  /// Returns all the atomic transactions within the given period.
+  ///
+  /// The ends of the period are found by binary search in a date
+  /// index, so that the cost only depends on the size of the result.
+  TransactionVector transactionsForPeriod(const Period & period);
+
+  /// Sets @a first and @a last so that the elements of transactions
+  /// from @a first (inclusive) to @a last (exclusive) are the ones
+  /// within the given period. Returns false if the transactions are
+  /// not sorted by date, in which case there is no such range.
+  bool transactionRange(const Period & period, int * first,
+                        int * last) const;
+
+  /// Marks the date index as stale. This must be called when
+  /// transactions are added, removed or when their date changes.
+  void invalidateDateIndex() {
+    dateIndexValid = false;
+  };
+
   /// Returns the Transaction objects of the account that belong to
   /// the given Category, or possibly to one of its descendants.
   TransactionPtrList taggedTransactions(const Tag * tag);
@@ -0,0 +1,193 @@
+/*
+    aggregatecube.cc: incrementally maintained statistics
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <aggregatecube.hh>
+#include <wallet.hh>
+#include <transactioncursor.hh>
+
+void AggregateSlice::addAmount(const Account * account, int month,
+                               int amount, int weight)
+{
+  Key k(account, month);
+  BasicStatistics & s = cells[k];
+  s.addAmount(amount, weight);
+  if(s.number == 0)
+    cells.remove(k);
+}
+
+void AggregateSlice::addTo(TransactionListStatistics & stats) const
+{
+  for(QHash<Key, BasicStatistics>::const_iterator i = cells.constBegin();
+      i != cells.constEnd(); i++) {
+    int month = i.key().second;
+    BasicStatistics s = i.value();
+    s.firstMonthID = i.key().first->firstMonthID();
+    stats += s;
+    if(month < 0)               // Invalid dates
+      continue;
+    stats.monthlyStats[month] += s;
+    stats.yearlyStats[month/12] += s;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+AggregateCube::AggregateCube(Wallet * w) :
+  wallet(w), valid(false), stamp(0), invalidationStamp(0)
+{
+}
+
+void AggregateCube::invalidate()
+{
+  clear();
+  invalidationStamp = ++stamp;
+  categoryStamps.clear();
+  tagStamps.clear();
+}
+
+void AggregateCube::clear()
+{
+  valid = false;
+  contributions.clear();
+  categorySlices.clear();
+  tagSlices.clear();
+  totalSlice.cells.clear();
+}
+
+AggregateCube::Contribution AggregateCube::contributionOf(const AtomicTransaction * t)
+{
+  Contribution c;
+  c.account = t->getAccount();
+  c.category = t->getCategory();
+  c.tags = t->tagSet();
+  QDate date = t->getDate();
+  c.month = date.isValid() ? AtomicTransaction::monthID(date) : -1;
+  c.amount = t->getAmount();
+  return c;
+}
+
+void AggregateCube::addContribution(const Contribution & c, int weight)
+{
+  categorySlices[c.category].addAmount(c.account, c.month, c.amount, weight);
+  for(int id : c.tags.ids())
+    tagSlices[wallet->tags.tagForID(id)].addAmount(c.account, c.month,
+                                                   c.amount, weight);
+  totalSlice.addAmount(c.account, c.month, c.amount, weight);
+}
+
+void AggregateCube::rebuild()
+{
+  clear();
+  for(int i = 0; i < wallet->accounts.size(); i++) {
+    for(const AtomicTransaction * t : AccountCursor(&wallet->accounts.at(i))) {
+      Contribution c = contributionOf(t);
+      addContribution(c, 1);
+      contributions[t] = c;
+    }
+  }
+  valid = true;
+}
+
+void AggregateCube::transactionChanged(const AtomicTransaction * transaction)
+{
+  Contribution c = contributionOf(transaction);
+  touchContribution(c);
+  if(! valid)
+    return;
+  QHash<const AtomicTransaction *, Contribution>::iterator i =
+    contributions.find(transaction);
+  if(i != contributions.end()) {
+    touchContribution(*i);
+    addContribution(*i, -1);
+    contributions.erase(i);
+  }
+  if(! c.account)
+    return;
+  addContribution(c, 1);
+  contributions[transaction] = c;
+}
+
+void AggregateCube::touchContribution(const Contribution & c)
+{
+  touchCategory(c.category);
+  for(int id : c.tags.ids())
+    touchTag(wallet->tags.tagForID(id));
+}
+
+void AggregateCube::touchCategory(const Category * category)
+{
+  ++stamp;
+  for(; category; category = category->parent)
+    categoryStamps[category] = stamp;
+}
+
+void AggregateCube::touchTag(const Tag * tag)
+{
+  if(tag)
+    tagStamps[tag] = ++stamp;
+}
+
+quint64 AggregateCube::categoryStamp(const Category * category) const
+{
+  return std::max(invalidationStamp, categoryStamps.value(category, 0));
+}
+
+quint64 AggregateCube::tagStamp(const Tag * tag) const
+{
+  return std::max(invalidationStamp, tagStamps.value(tag, 0));
+}
+
+QList<const AggregateSlice *> AggregateCube::categorySlicesFor(const Category * category,
+                                                              bool subCategories)
+{
+  ensureValid();
+  QList<const AggregateSlice *> ret;
+  QVector<const Category *> cats;
+  if(subCategories && category)
+    cats = wallet->categories.subTree(category);
+  else
+    cats << category;
+  for(const Category * c : cats) {
+    QHash<const Category *, AggregateSlice>::const_iterator i =
+      categorySlices.constFind(c);
+    if(i != categorySlices.constEnd())
+      ret << &(*i);
+  }
+  return ret;
+}
+
+TransactionListStatistics AggregateCube::categoryStatistics(const Category * category,
+                                                            bool subCategories)
+{
+  TransactionListStatistics ret;
+  for(const AggregateSlice * s : categorySlicesFor(category, subCategories))
+    s->addTo(ret);
+  return ret;
+}
+
+TransactionListStatistics AggregateCube::tagStatistics(const Tag * tag)
+{
+  ensureValid();
+  TransactionListStatistics ret;
+  QHash<const Tag *, AggregateSlice>::const_iterator i =
+    tagSlices.constFind(tag);
+  if(i != tagSlices.constEnd())
+    i->addTo(ret);
+  return ret;
+}
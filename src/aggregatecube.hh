@@ -0,0 +1,200 @@
+/**
+    \file aggregatecube.hh
+    Incrementally maintained statistics by account, category, tag and month
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __AGGREGATECUBE_HH
+#define __AGGREGATECUBE_HH
+
+#include <transactionlists.hh>
+#include <tag.hh>
+
+class Wallet;
+class Account;
+class Category;
+
+/// The BasicStatistics of one Category, one Tag or of all the
+/// transactions, by account and month.
+class AggregateSlice {
+public:
+
+  typedef QPair<const Account *, int> Key;
+
+  /// The cells, indexed by account and month ID.
+  QHash<Key, BasicStatistics> cells;
+
+  /// Adds (or removes, if @a weight is negative) a transaction to the
+  /// cell. Cells left empty are removed.
+  void addAmount(const Account * account, int month,
+                 int amount, int weight);
+
+  /// Adds the whole contents of the slice to @a stats, including the
+  /// monthly and yearly breakdown.
+  void addTo(TransactionListStatistics & stats) const;
+};
+
+/// This class maintains a "cube" of BasicStatistics by account,
+/// category (or tag) and month for the whole Wallet, so that the
+/// statistics of the StatisticsModel can be computed by a few lookups
+/// rather than by rescanning the transactions.
+///
+/// The budget views do not use it: they sum the transactions of the
+/// BudgetRealization objects, which are not tied to a category.
+///
+/// Like CategorizationIndex, it is built lazily on the first query
+/// and then kept up to date by transactionChanged(), which
+/// AtomicTransaction calls whenever its category, tags, amount or
+/// date change. Updates cost a few hash operations, whatever the size
+/// of the Wallet. Structural changes should call invalidate().
+///
+/// The cube is derived data and is not saved: it is rebuilt in a
+/// single pass over the transactions after loading.
+///
+/// It also keeps track of when each Category and Tag last changed
+/// (see categoryStamp()), so that caches of data derived from the
+/// transactions can tell whether they are still valid.
+class AggregateCube {
+
+  /// What a transaction was last accounted for.
+  class Contribution {
+  public:
+    const Account * account;
+    const Category * category;
+    TagSet tags;
+    int month;
+    int amount;
+  };
+
+  /// The wallet whose transactions are aggregated
+  Wallet * wallet;
+
+  /// Whether the cube is up-to-date
+  bool valid;
+
+  /// The current contribution of every transaction
+  QHash<const AtomicTransaction *, Contribution> contributions;
+
+  /// Statistics by category. The NULL key holds uncategorized
+  /// transactions.
+  QHash<const Category *, AggregateSlice> categorySlices;
+
+  /// Statistics by tag
+  QHash<const Tag *, AggregateSlice> tagSlices;
+
+  /// Statistics of all the transactions
+  AggregateSlice totalSlice;
+
+  /// The stamp of the last change
+  quint64 stamp;
+
+  /// The stamp of the last invalidate()
+  quint64 invalidationStamp;
+
+  /// The stamp of the last change of each Category, including the
+  /// changes of its descendants.
+  QHash<const Category *, quint64> categoryStamps;
+
+  /// The stamp of the last change of each Tag
+  QHash<const Tag *, quint64> tagStamps;
+
+  /// Marks the category and tags of the contribution as changed
+  void touchContribution(const Contribution & c);
+
+  /// Clears the data, but not the stamps
+  void clear();
+
+  /// Computes the contribution of the transaction as of now.
+  static Contribution contributionOf(const AtomicTransaction * t);
+
+  /// Adds the contribution to all the relevant slices, or removes it
+  /// if @a weight is -1.
+  void addContribution(const Contribution & c, int weight);
+
+  /// Rebuilds the whole cube.
+  void rebuild();
+
+  /// Makes sure the cube is up-to-date
+  void ensureValid() {
+    if(! valid)
+      rebuild();
+  };
+
+  /// The slices of the category, and of all its descendants if
+  /// @a subCategories is true.
+  QList<const AggregateSlice *> categorySlicesFor(const Category * category,
+                                                  bool subCategories);
+
+public:
+
+  AggregateCube(Wallet * wallet);
+
+  /// Marks the whole cube as stale. It will be rebuilt on the next
+  /// query.
+  void invalidate();
+
+  /// Updates the contribution of the given transaction. Only the
+  /// stamps are updated when the cube is not built yet.
+  void transactionChanged(const AtomicTransaction * transaction);
+
+  /// @name Change tracking
+  ///
+  /// Every change gets a new, increasing, stamp. Data computed when
+  /// currentStamp() was S is still valid as long as the stamp of what
+  /// it depends on is not greater than S.
+  ///
+  /// @{
+
+  /// The stamp of the last change
+  quint64 currentStamp() const {
+    return stamp;
+  };
+
+  /// The stamp of the last change that affected the transactions of
+  /// the given Category or of any of its descendants.
+  quint64 categoryStamp(const Category * category) const;
+
+  /// The stamp of the last change that affected the transactions of
+  /// the given Tag.
+  quint64 tagStamp(const Tag * tag) const;
+
+  /// Marks the category (and its ancestors) as changed. To be used
+  /// when a transaction leaves a category.
+  void touchCategory(const Category * category);
+
+  /// Marks the tag as changed.
+  void touchTag(const Tag * tag);
+
+  /// @}
+
+  /// @name Queries
+  ///
+  /// @{
+
+  /// Detailed statistics of the whole history of the given Category,
+  /// the same as those of TransactionPtrList::statistics() on
+  /// Wallet::categoryTransactions().
+  TransactionListStatistics categoryStatistics(const Category * category,
+                                               bool subCategories = true);
+
+  /// Detailed statistics of the whole history of the given Tag.
+  TransactionListStatistics tagStatistics(const Tag * tag);
+
+  /// @}
+};
+
+#endif
@@ -0,0 +1,124 @@
+/**
+    \file amountkernels.hh
+    Reductions over contiguous arrays of amounts
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __AMOUNTKERNELS_HH
+#define __AMOUNTKERNELS_HH
+
+/// The result of sumAmounts() and its masked variants
+class AmountSums {
+public:
+  int number = 0;
+  int numberCredit = 0;
+  int numberDebit = 0;
+
+  qint64 totalCredit = 0;
+  qint64 totalDebit = 0;
+
+  qint64 total() const {
+    return totalCredit + totalDebit;
+  };
+};
+
+/// The result of amountRange()
+class AmountRange {
+public:
+  /// Only meaningful if the array was not empty
+  int minimum = 0;
+  int maximum = 0;
+};
+
+/// Computes the sums of the credits and debits of the @a n amounts
+/// for which @a selected(i) is 1 (it must return 0 or 1). The loop
+/// has no branches and no dependencies between iterations other than
+/// the accumulators, so that the compiler can vectorize it, provided
+/// the mask is simple enough (see sumAmountsBetween() and
+/// sumAmountsOfCategory()).
+template <class Mask>
+inline AmountSums sumAmountsIf(const int * amounts, int n, Mask selected)
+{
+  AmountSums rv;
+  qint64 credit = 0, debit = 0;
+  int nb = 0, nDebit = 0;
+  for(int i = 0; i < n; i++) {
+    const int sel = selected(i);
+    const int a = (sel ? amounts[i] : 0);
+    const int neg = (a < 0);
+    debit += (neg ? a : 0);
+    credit += (neg ? 0 : a);
+    nDebit += neg;
+    nb += sel;
+  }
+
+  rv.number = nb;
+  rv.numberDebit = nDebit;
+  rv.numberCredit = nb - nDebit;
+  rv.totalCredit = credit;
+  rv.totalDebit = debit;
+  return rv;
+}
+
+/// Computes the sums of the credits and debits of the @a n amounts.
+inline AmountSums sumAmounts(const int * amounts, int n)
+{
+  return sumAmountsIf(amounts, n, [](int) -> int {
+      return 1;
+    });
+}
+
+/// Same as sumAmounts(), but only for the amounts whose day number
+/// (typically a QDate::toJulianDay()) is between @a firstDay and
+/// @a lastDay, inclusive.
+inline AmountSums sumAmountsBetween(const int * amounts, const int * days,
+                                    int n, int firstDay, int lastDay)
+{
+  return sumAmountsIf(amounts, n, [days, firstDay, lastDay](int i) -> int {
+      return (days[i] >= firstDay) & (days[i] <= lastDay);
+    });
+}
+
+/// Same as sumAmounts(), but only for the amounts whose category
+/// number is @a category.
+inline AmountSums sumAmountsOfCategory(const int * amounts,
+                                       const int * categories,
+                                       int n, int category)
+{
+  return sumAmountsIf(amounts, n, [categories, category](int i) -> int {
+      return categories[i] == category;
+    });
+}
+
+/// Computes the extrema of the @a n amounts.
+inline AmountRange amountRange(const int * amounts, int n)
+{
+  AmountRange rv;
+  if(n <= 0)
+    return rv;
+  int mn = amounts[0], mx = amounts[0];
+  for(int i = 1; i < n; i++) {
+    const int a = amounts[i];
+    mn = (a < mn ? a : mn);
+    mx = (a > mx ? a : mx);
+  }
+  rv.minimum = mn;
+  rv.maximum = mx;
+  return rv;
+}
+
+#endif
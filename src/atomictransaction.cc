@@ -20,6 +20,7 @@
 #include <transaction.hh>
 #include <account.hh>
 #include <wallet.hh>
+#include <budget.hh>
 
 
 AtomicTransaction::AtomicTransaction(int am, Transaction * bt) :
@@ -78,15 +79,96 @@ QString AtomicTransaction::getCheckNumber() const
 
 AttributeHash AtomicTransaction::toHash() const
 {
+  // QStringLiteral keys do not allocate memory
   AttributeHash retval;
-  retval["amount"] = getAmount();
-  retval["date"] = getDate();
-  retval["memo"] = getMemo();
-  retval["name"] = getName();
+  retval.reserve(4);
+  retval.insert(QStringLiteral("amount"), getAmount());
+  retval.insert(QStringLiteral("date"), getDate());
+  retval.insert(QStringLiteral("memo"), getMemo());
+  retval.insert(QStringLiteral("name"), getName());
 
   return retval;
 }
 
+void AtomicTransaction::setComment(const QString & cmt)
+{
+  if(comment == cmt)
+    return;
+  setAttribute(comment, cmt, "comment");
+  Account * ac = getAccount();
+  if(ac && ac->wallet)
+    ac->wallet->textIndex.transactionChanged(this);
+}
+
+CategorizationIndex * AtomicTransaction::categorizationIndex() const
+{
+  Account * ac = getAccount();
+  if(ac && ac->wallet)
+    return &ac->wallet->categorizationIndex;
+  return NULL;
+}
+
+AggregateCube * AtomicTransaction::aggregateCube() const
+{
+  Account * ac = getAccount();
+  if(ac && ac->wallet)
+    return &ac->wallet->aggregates;
+  return NULL;
+}
+
+void AtomicTransaction::categoryChanged(Category * old)
+{
+  CategorizationIndex * idx = categorizationIndex();
+  if(idx)
+    idx->categoryChanged(this, old);
+  AggregateCube * cube = aggregateCube();
+  if(cube) {
+    cube->touchCategory(old);
+    cube->transactionChanged(this);
+  }
+}
+
+void AtomicTransaction::tagChanged(Tag * tag, bool set)
+{
+  CategorizationIndex * idx = categorizationIndex();
+  if(idx)
+    idx->tagChanged(this, tag, set);
+  AggregateCube * cube = aggregateCube();
+  if(cube) {
+    cube->touchTag(tag);
+    cube->transactionChanged(this);
+  }
+}
+
+void AtomicTransaction::notifyRealizations(int delta)
+{
+  for(BudgetRealization * r :
+        links.typedLinks<BudgetRealization>("budget-realization"))
+    r->linkedAmountChanged(delta);
+}
+
+void AtomicTransaction::setAmount(int amnt)
+{
+  if(amount == amnt)
+    return;
+  int delta = amnt - amount;
+  setAttribute(amount, amnt, "amount");
+
+  // Keep the realized amounts of the budgets up-to-date
+  notifyRealizations(delta);
+  if(baseTransaction)
+    baseTransaction->notifyRealizations(-delta);
+
+  AggregateCube * cube = aggregateCube();
+  if(cube) {
+    cube->transactionChanged(this);
+    // The amount of the base transaction is what is left from the
+    // sub-transactions.
+    if(baseTransaction)
+      cube->transactionChanged(baseTransaction);
+  }
+}
+
 int AtomicTransaction::monthID() const
 {
   return monthID(getDate());
@@ -31,6 +31,8 @@ class Wallet;
 class Account;
 
 class Transaction;
+class CategorizationIndex;
+class AggregateCube;
 
 /// This reprensents an atomic transaction, ie what is left after you
 /// split a Transaction into several sub-transactions. 
@@ -47,6 +49,22 @@ protected:
   /// transaction to come later.
   bool previsional;
 
+  /// Returns the CategorizationIndex of the Wallet the transaction
+  /// belongs to, or NULL if there isn't one.
+  CategorizationIndex * categorizationIndex() const;
+
+  /// Returns the AggregateCube of the Wallet the transaction belongs
+  /// to, or NULL if there isn't one.
+  AggregateCube * aggregateCube() const;
+
+  /// Forwards the change to the categorizationIndex() and the
+  /// aggregateCube()
+  virtual void categoryChanged(Category * old) override;
+
+  /// Forwards the change to the categorizationIndex() and the
+  /// aggregateCube()
+  virtual void tagChanged(Tag * tag, bool set) override;
+
 public:
 
   /// The transaction this one is derived from. If not NULL, then this
@@ -110,9 +128,13 @@ public:
     return amount;
   };
 
-  void setAmount(int amnt) {
-    setAttribute(amount, amnt, "amount");
-  }
+  /// Sets the amount. This also changes the amount of the
+  /// baseTransaction, if any.
+  void setAmount(int amnt);
+
+  /// Tells the BudgetRealization objects linked to this transaction
+  /// that getAmount() changed by @a delta.
+  void notifyRealizations(int delta);
 
   virtual int getTotalAmount() const {
     return amount;
@@ -129,10 +151,8 @@ public:
     return comment;
   };
 
-  /// Sets the comment  
-  void setComment(const QString & cmt) {
-    setAttribute(comment, cmt, "comment");
-  };
+  /// Sets the comment, and updates the TransactionTextIndex.
+  void setComment(const QString & cmt);
 
   virtual QString getCheckNumber() const;
 
@@ -80,7 +80,7 @@ void AttributeHash::readXML(XmlReader * reader)
   // Once again, this function only reads one element; assumes to be
   // just at the beginning of the element.
   QXmlStreamAttributes attrs = reader->attributes();
-  QString name = attrs.value("name").toString();
+  QString name = internKey(attrs.value("name").toString());
   HandledType t = namedType(attrs.value("type").toString());
   QString value = attrs.value("value").toString();
   Serialization::readNextToken(reader);
@@ -104,37 +104,127 @@ static const char * fsRE = "%\\{([^%}]+)(%[^}]+)?\\}";
 
 QString AttributeHash::formatString(const QString & format) const
 {
-  QString str;
+  return FormatTemplate::compiled(format).render(*this);
+}
+
+AttributeHash::FormatTemplate::FormatTemplate(const QString & format) :
+  literalSize(0)
+{
+  // This is a hand-written version of the search for fsRE: %{, the
+  // key (no % nor }), optionally % and a non-empty spec (no }), then }.
+  int size = format.size();
+  int last = 0;
   int idx = 0;
-  int lastidx;
-  QRegExp formatSpecifierRE(fsRE);
-  // formatSpecifierRE.setMinimal(true); // Non-greedy regular expressions !
-  while(idx >= 0) {
-    lastidx = idx;
-    idx = formatSpecifierRE.indexIn(format, idx);
-    if(idx < 0) {
-      str += format.mid(lastidx);
-    }
-    else {
-      // prefix.
-      str += format.mid(lastidx, idx - lastidx);
-      // Now, we have fun
-      if(! contains(formatSpecifierRE.cap(1)))
-	str += "undef";
-      else {
-	// handle formats !
-	if(formatSpecifierRE.cap(2).isEmpty())
-	  str += value(formatSpecifierRE.cap(1)).toString();
-	else
-	  str += formatVariant(value(formatSpecifierRE.cap(1)),
-			       formatSpecifierRE.cap(2).mid(1));
+  while(true) {
+    int start = format.indexOf("%{", idx);
+    if(start < 0)
+      break;
+    idx = start + 1;            // Where to look next if this one fails
+
+    int end = start + 2;
+    while(end < size && format[end] != '%' && format[end] != '}')
+      ++end;
+    if(end == start + 2 || end >= size)
+      continue;
+    Segment field;
+    field.kind = Plain;
+    field.text = format.mid(start + 2, end - start - 2);
+    if(format[end] == '%') {
+      int close = format.indexOf('}', end + 1);
+      if(close < 0 || close == end + 1)
+        continue;
+      QString spec = format.mid(end + 1, close - end - 1);
+      if(spec.size() == 1) {
+        switch(spec[0].toLatin1()) {
+        case 'A':
+          field.kind = Amount;
+          break;
+        case 'M':
+          field.kind = Month;
+          break;
+        case 'y':
+          field.kind = Year;
+          break;
+        default:
+          ;
+        }
       }
-      idx += formatSpecifierRE.cap(0).size();
-     }
+      else if(spec.startsWith("date:")) {
+        field.kind = Date;
+        field.dateFormat = spec.mid(5);
+      }
+      end = close;
+    }
+
+    if(start > last) {
+      Segment lit;
+      lit.kind = Literal;
+      lit.text = format.mid(last, start - last);
+      literalSize += lit.text.size();
+      segments << lit;
+    }
+    segments << field;
+    last = idx = end + 1;
+  }
+  if(last < size) {
+    Segment lit;
+    lit.kind = Literal;
+    lit.text = format.mid(last);
+    literalSize += lit.text.size();
+    segments << lit;
+  }
+}
+
+QString AttributeHash::FormatTemplate::render(const AttributeHash & attrs) const
+{
+  QString str;
+  str.reserve(literalSize + 16 * segments.size());
+  for(const Segment & s : segments) {
+    if(s.kind == Literal) {
+      str += s.text;
+      continue;
+    }
+    AttributeHash::const_iterator it = attrs.constFind(s.text);
+    if(it == attrs.constEnd()) {
+      str += "undef";
+      continue;
+    }
+    const QVariant & v = it.value();
+    switch(s.kind) {
+    case Amount:
+      str += Transaction::formatAmount(v.toLongLong());
+      break;
+    case Month:
+      str += v.toDateTime().toString("MM");
+      break;
+    case Year:
+      str += v.toDateTime().toString("yyyy");
+      break;
+    case Date:
+      str += v.toDateTime().toString(s.dateFormat);
+      break;
+    default:
+      str += v.toString();
+    }
   }
   return str;
 }
 
+const AttributeHash::FormatTemplate &
+AttributeHash::FormatTemplate::compiled(const QString & format)
+{
+  // One cache per thread, so that no locking is needed.
+  static thread_local QHash<QString, FormatTemplate> cache;
+  QHash<QString, FormatTemplate>::const_iterator it = cache.constFind(format);
+  if(it != cache.constEnd())
+    return it.value();
+  // The formats typed by the user (see
+  // DocumentsPage::renameWithPattern()) could fill the cache forever
+  if(cache.size() >= 256)
+    cache.clear();
+  return cache.insert(format, FormatTemplate(format)).value();
+}
+
 
 QString AttributeHash::formatVariant(QVariant v, const QString &spec)
 {
@@ -322,8 +412,8 @@ void AttributeHash::connectEditorChanged(HandledType type, QWidget * editor,
 QVariant AttributeHash::toScript() const
 {
   QVariantMap m;
-  for(const QString & n : keys())
-    m.insert(n, (*this)[n]);
+  for(const_iterator i = constBegin(); i != constEnd(); ++i)
+    m.insert(i.key(), i.value());
   return QVariant::fromValue(m);
 }
 
@@ -331,8 +421,21 @@ AttributeHash AttributeHash::fromScript(const QVariant & value)
 {
   QVariantMap m = value.toMap();
   AttributeHash rv;
-  for(const QString & n : m.keys())
-    rv[n] = m[n];
+  rv.reserve(m.size());
+  for(QVariantMap::const_iterator i = m.constBegin(); i != m.constEnd(); ++i)
+    rv.insert(internKey(i.key()), i.value());
   return rv;
 }
 
+QString AttributeHash::internKey(const QString & key)
+{
+  static QMutex mutex;
+  static QSet<QString> keys;
+  QMutexLocker l(&mutex);
+  QSet<QString>::const_iterator i = keys.constFind(key);
+  if(i != keys.constEnd())
+    return *i;
+  keys.insert(key);
+  return key;
+}
+
@@ -73,8 +73,50 @@ public:
   /// the documentation of formatVariant for more documentation.
   ///
   /// \warning Keys that contain % will not be interpreted correctly !
+  ///
+  /// The format is only parsed the first time it is seen in a given
+  /// thread (see FormatTemplate::compiled()).
   QString formatString(const QString & format) const;
 
+  /// A format string as accepted by formatString(), parsed once and
+  /// for all into literal text and fields, whose format conversion is
+  /// resolved in advance.
+  class FormatTemplate {
+    enum Kind {
+      Literal,
+      /// No format, or one not handled by formatVariant()
+      Plain,
+      Amount,
+      Month,
+      Year,
+      Date
+    };
+
+    class Segment {
+    public:
+      Kind kind;
+      /// The literal text, or the key of the field
+      QString text;
+      /// The format for Date
+      QString dateFormat;
+    };
+
+    QVector<Segment> segments;
+
+    /// The size of the literal text
+    int literalSize;
+
+  public:
+    explicit FormatTemplate(const QString & format = QString());
+
+    /// Same as AttributeHash::formatString().
+    QString render(const AttributeHash & attributes) const;
+
+    /// Returns the template for the given format, from a per-thread
+    /// cache. The reference is only valid until the next call.
+    static const FormatTemplate & compiled(const QString & format);
+  };
+
   /// Formats the given variant according to the given format:
   ///
   /// \li A: v is an integer converted to an amount using
@@ -91,6 +133,12 @@ public:
   /// The names of numbered types
   static const char * typeNames[];
 
+  /// Returns a copy of the key that shares its data with all the
+  /// other keys with the same value, so that the keys of the
+  /// attributes of thousands of documents only use memory once.
+  /// Thread-safe.
+  static QString internKey(const QString & key);
+
   static HandledType namedType(const QString & name);
 
   /// This object, just like Serializable ones, shouldn't be deleted.
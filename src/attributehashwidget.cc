@@ -84,6 +84,7 @@ void AttributeHashElementWidget::onValueChanged()
   QString tg = nameEditor->text();
   if(! tg.isEmpty())
     (*target)[tg] = AttributeHash::getEditorValue(currentType, valueEditor);
+  emit(changed());
 }
 
 void AttributeHashElementWidget::onNameChanged(const QString & ne)
@@ -91,6 +92,7 @@ void AttributeHashElementWidget::onNameChanged(const QString & ne)
   QVariant v = target->take(lastName);
   (*target)[ne] = v;
   lastName = ne;
+  emit(changed());
 }
 
 void AttributeHashElementWidget::onTypeChanged(const QString & ne)
@@ -126,6 +128,7 @@ void AttributeHashWidget::addWidget(AttributeHashElementWidget * ed)
   deleteMapper->setMapping(ed, editors.size());
   connect(ed, SIGNAL(deletePressed()), deleteMapper, SLOT(map()));
   connect(ed, SIGNAL(addPressed()), SLOT(addElement()));
+  connect(ed, SIGNAL(changed()), SIGNAL(hashChanged()));
   editors << ed;
   layout->addWidget(ed);
 }
@@ -78,6 +78,9 @@ signals:
   void deletePressed();
   void addPressed();
 
+  /// Emitted when the target hash was modified
+  void changed();
+
 protected slots:
   void onValueChanged();
   void onNameChanged(const QString & ne);
@@ -121,6 +124,10 @@ public slots:
   void addElement();
 
   void deleteElement(int idx);
+
+signals:
+  /// Emitted whenever the user modifies the target hash
+  void hashChanged();
 };
 
 
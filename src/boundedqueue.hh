@@ -0,0 +1,104 @@
+/**
+    \file boundedqueue.hh
+    A blocking queue of limited capacity, to connect pipeline stages
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __BOUNDEDQUEUE_HH
+#define __BOUNDEDQUEUE_HH
+
+/// A thread-safe FIFO holding at most a given number of elements.
+///
+/// push() blocks while the queue is full, which keeps fast producers
+/// from piling up data in front of a slow consumer. pop() blocks
+/// while the queue is empty, until all the producers have called
+/// producerDone(); tryPop() only waits for a limited time.
+template <class T> class BoundedQueue {
+  QMutex mutex;
+  QWaitCondition notFull;
+  QWaitCondition notEmpty;
+
+  QQueue<T> items;
+
+  /// The maximum number of elements
+  int capacity;
+
+  /// The number of producers that have not called producerDone() yet.
+  int producers;
+
+public:
+
+  /// The outcome of tryPop()
+  enum PopResult {
+    Popped,
+    TimedOut,
+    Finished
+  };
+
+  explicit BoundedQueue(int cap, int prods = 1) :
+    capacity(std::max(cap, 1)), producers(prods) {
+  };
+
+  /// Adds an element, waiting for room if necessary.
+  void push(const T & value) {
+    QMutexLocker l(&mutex);
+    while(items.size() >= capacity)
+      notFull.wait(&mutex);
+    items.enqueue(value);
+    notEmpty.wakeOne();
+  };
+
+  /// Takes the oldest element, waiting for one if necessary. Returns
+  /// false, without touching @a value, once the queue is empty and
+  /// all the producers are done.
+  bool pop(T * value) {
+    QMutexLocker l(&mutex);
+    while(items.isEmpty()) {
+      if(producers <= 0)
+        return false;
+      notEmpty.wait(&mutex);
+    }
+    *value = items.dequeue();
+    notFull.wakeOne();
+    return true;
+  };
+
+  /// Same as pop(), but waits at most @a ms milliseconds for an
+  /// element.
+  PopResult tryPop(T * value, unsigned long ms) {
+    QMutexLocker l(&mutex);
+    if(items.isEmpty()) {
+      if(producers <= 0)
+        return Finished;
+      notEmpty.wait(&mutex, ms);
+      if(items.isEmpty())
+        return producers <= 0 ? Finished : TimedOut;
+    }
+    *value = items.dequeue();
+    notFull.wakeOne();
+    return Popped;
+  };
+
+  /// Signals that one of the producers will not push anymore.
+  void producerDone() {
+    QMutexLocker l(&mutex);
+    --producers;
+    notEmpty.wakeAll();
+  };
+};
+
+#endif
@@ -26,8 +26,13 @@
 #include <navigationwidget.hh>
 #include <budgetpage.hh>
 #include <account.hh>
+#include <wallet.hh>
+#include <amountkernels.hh>
 
-Budget::Budget() : amount(0), periodicity(1), exceptional(false)
+#include <climits>
+
+Budget::Budget() : amount(0), periodicity(1), exceptional(false),
+                   indexedRealizations(0), indexIsExact(true)
 {
   
 }
@@ -47,15 +52,61 @@ void Budget::finishedSerializationRead()
 {
   for(int i = 0; i < realizations.size(); i++)
     realizations[i].budget = this;
+  rebuildRealizationIndex();
+}
+
+void Budget::indexRealization(int i)
+{
+  const Period & p = realizations[i].period;
+  QMap<QDate, int>::iterator it = startIndex.lowerBound(p.startDate);
+  if(it != startIndex.end() && it.key() == p.startDate) {
+    // Only the first realization starting at a date is indexed
+    indexIsExact = false;
+    return;
+  }
+  // It is enough to check the overlap with the neighbours
+  if(it != startIndex.end() &&
+     realizations[it.value()].period.startDate <= p.endDate)
+    indexIsExact = false;
+  if(it != startIndex.begin() &&
+     realizations[(it - 1).value()].period.endDate >= p.startDate)
+    indexIsExact = false;
+  startIndex.insert(it, p.startDate, i);
+}
+
+void Budget::rebuildRealizationIndex()
+{
+  startIndex.clear();
+  indexIsExact = true;
+  for(int i = 0; i < realizations.size(); i++)
+    indexRealization(i);
+  indexedRealizations = realizations.size();
+}
+
+const QMap<QDate, int> & Budget::realizationIndex()
+{
+  if(indexedRealizations != realizations.size())
+    rebuildRealizationIndex();
+  return startIndex;
 }
 
 BudgetRealization * Budget::realizationForDate(const QDate & date, bool create)
 {
   if(! date.isValid())
     return NULL;
-  for(int i = 0; i < realizations.size(); i++) {
-    if(realizations[i].contains(date))
-      return &realizations[i];
+  const QMap<QDate, int> & idx = realizationIndex();
+  QMap<QDate, int>::const_iterator it = idx.upperBound(date);
+  if(it != idx.constBegin()) {
+    --it;
+    if(realizations[it.value()].contains(date))
+      return &realizations[it.value()];
+  }
+  if(! indexIsExact) {
+    // Only when the periods overlap, which should be rare.
+    for(int i = 0; i < realizations.size(); i++) {
+      if(realizations[i].contains(date))
+        return &realizations[i];
+    }
   }
   if(! create)
     return NULL;
@@ -63,6 +114,8 @@ BudgetRealization * Budget::realizationForDate(const QDate & date, bool create)
   BudgetRealization & lst = realizations.last();
   lst.budget = this;
   lst.period = periodicity.periodForDate(date);
+  indexRealization(realizations.size() - 1);
+  ++indexedRealizations;
   return &lst;
 }
 
@@ -78,6 +131,15 @@ QHash<Period, BudgetRealization *> Budget::realizationsForPeriod(const Period &
   return rv;
 }
 
+int Budget::amountRealized(const Period & period)
+{
+  int rv = 0;
+  for(BudgetRealization * r : realizationsForPeriod(period))
+    if(r)
+      rv += r->amountRealized();
+  return rv;
+}
+
 TransactionPtrList Budget::allTransactions() const
 {
   TransactionPtrList lst;
@@ -103,10 +165,49 @@ QDate Budget::earliestDate() const
 
 //////////////////////////////////////////////////////////////////////
 
-BudgetRealization::BudgetRealization() : budget(NULL)
+BudgetRealization::BudgetRealization() :
+  cacheValid(false), cachedRealized(0), budget(NULL)
 {
 }
 
+void BudgetRealization::ensureCache() const
+{
+  if(cacheValid)
+    return;
+  cachedTransactions =
+    links.typedLinks<AtomicTransaction>("budget-realization");
+  cachedRealized = 0;
+  for(const AtomicTransaction * t : cachedTransactions)
+    cachedRealized += t->getAmount();
+  cacheValid = true;
+}
+
+void BudgetRealization::linkAdded(Linkable * target, const QString & name)
+{
+  if(! cacheValid || name != "budget-realization")
+    return;
+  AtomicTransaction * t = dynamic_cast<AtomicTransaction *>(target);
+  if(t) {
+    cachedTransactions << t;
+    cachedRealized += t->getAmount();
+  }
+}
+
+void BudgetRealization::linkRemoved(Linkable * target, const QString & name)
+{
+  if(! cacheValid || name != "budget-realization")
+    return;
+  AtomicTransaction * t = dynamic_cast<AtomicTransaction *>(target);
+  if(t && cachedTransactions.removeOne(t))
+    cachedRealized -= t->getAmount();
+}
+
+void BudgetRealization::linkedAmountChanged(int delta)
+{
+  if(cacheValid)
+    cachedRealized += delta;
+}
+
 SerializationAccessor * BudgetRealization::serializationAccessor()
 {
   SerializationAccessor * ac = new SerializationAccessor(this);
@@ -155,10 +256,9 @@ void BudgetRealization::followLink()
 
 TransactionPtrList BudgetRealization::transactions() const
 {
-  QList<AtomicTransaction*> transactions =
-    links.typedLinks<AtomicTransaction>("budget-realization");
+  ensureCache();
   TransactionPtrList lst;
-  lst.append(transactions);
+  lst.append(cachedTransactions);
   return lst;
 }
 
@@ -170,19 +270,13 @@ int BudgetRealization::amountPlanned() const
 
 int BudgetRealization::amountRealized() const
 {
-  int rv = 0;
-  QList<AtomicTransaction*> transactions =
-    links.typedLinks<AtomicTransaction>("budget-realization");
-
-  for(int i = 0; i < transactions.size(); i++)
-    rv += transactions[i]->getAmount();
-    
-  return rv;
+  ensureCache();
+  return cachedRealized;
 }
 
-TransactionPtrList BudgetRealization::realizationLessTransactions(const TransactionPtrList & lst)
+TransactionVector BudgetRealization::realizationLessTransactions(const TransactionVector & lst)
 {
-  TransactionPtrList rv;
+  TransactionVector rv;
   for(int i = 0; i < lst.size(); i++) {
     AtomicTransaction * t = lst[i];
     QList<BudgetRealization*> rl =
@@ -195,13 +289,22 @@ TransactionPtrList BudgetRealization::realizationLessTransactions(const Transact
   
 //////////////////////////////////////////////////////////////////////
 
+void BudgetStats::addStats(const PeriodStats & s)
+{
+  stats << s;
+  plannedColumn << s.planned;
+  realizedColumn << s.realized;
+  startDays << s.period.startDate.toJulianDay();
+  endDays << s.period.endDate.toJulianDay();
+}
+
 void BudgetStats::addRealization(const BudgetRealization * realization)
 {
   PeriodStats s;
   s.period = realization->period;
   s.planned = realization->amountPlanned();
   s.realized = realization->amountRealized();
-  stats << s;
+  addStats(s);
 }
 
 void BudgetStats::addBudget(const Budget * budget, const Period & period)
@@ -210,49 +313,100 @@ void BudgetStats::addBudget(const Budget * budget, const Period & period)
   s.period = period;
   s.planned = budget->amount[period.startDate];
   s.realized = 0;
-  stats << s;
+  addStats(s);
 }
 
 int BudgetStats::realized() const
 {
-  int rv = 0;
-  for(const PeriodStats & s : stats)
-    rv += s.realized;
-  return rv;
+  return sumAmounts(realizedColumn.constData(), realizedColumn.size()).total();
 }
 
 int BudgetStats::planned() const
 {
-  int rv = 0;
-  for(const PeriodStats & s : stats)
-    rv += s.planned;
-  return rv;
+  return sumAmounts(plannedColumn.constData(), plannedColumn.size()).total();
 }
 
 int BudgetStats::effective(const QDate & ref) const
 {
-  int effective = 0;
-  for(const PeriodStats & s : stats) {
-    if(s.period.startDate > ref) {
-      // planification
-      effective += s.planned;
-    }
-    else if(s.period.endDate < ref) {
-      // past
-      effective += s.realized;
-    }
-    else {
-      // current
-      if(s.planned > 0) {
-        effective += std::max(s.realized, s.planned);
-      }
-      else if(s.planned < 0) {
-        effective += std::min(s.realized, s.planned);
-      }
-      else
-        effective += s.realized;
-    }
+  const int n = stats.size();
+  const int day = ref.toJulianDay();
+  // planification
+  int effective = sumAmountsBetween(plannedColumn.constData(),
+                                    startDays.constData(), n,
+                                    day + 1, INT_MAX).total();
+  // past
+  effective += sumAmountsBetween(realizedColumn.constData(),
+                                 endDays.constData(), n,
+                                 INT_MIN, day - 1).total();
+  // current, which concerns very few periods
+  for(int i = 0; i < n; i++) {
+    if(startDays[i] > day || endDays[i] < day)
+      continue;
+    const int planned = plannedColumn[i];
+    const int realized = realizedColumn[i];
+    if(planned > 0)
+      effective += std::max(realized, planned);
+    else if(planned < 0)
+      effective += std::min(realized, planned);
+    else
+      effective += realized;
   }
   return effective;
 }
 
+//////////////////////////////////////////////////////////////////////
+
+BudgetSummary::BudgetSummary(Wallet * wallet, int fy, int ly) :
+  firstYear(fy), lastYear(ly)
+{
+  const int years = lastYear - firstYear + 1;
+  for(const Budget * budget : wallet->budgets.pointerList()) {
+    QVector<int> & amounts = realizedAmounts[budget];
+    amounts.fill(0, years);
+    for(const BudgetRealization & r : budget->realizations) {
+      int y1 = std::max(r.period.startDate.year(), firstYear);
+      int y2 = std::min(r.period.endDate.year(), lastYear);
+      if(y1 > y2)
+        continue;
+      int amount = r.amountRealized();
+      for(int y = y1; y <= y2; y++)
+        amounts[y - firstYear] += amount;
+    }
+  }
+
+  unbudgetedTransactions.resize(12 * years);
+  unbudgetedAmounts.fill(0, 12 * years);
+  Period range = Period::year(firstYear).unite(Period::year(lastYear));
+  const int firstMonth = AtomicTransaction::monthID(range.startDate);
+  for(AtomicTransaction * t :
+        BudgetRealization::realizationLessTransactions(wallet->transactionsForPeriod(range))) {
+    int idx = t->monthID() - firstMonth;
+    unbudgetedTransactions[idx] << t;
+    unbudgetedAmounts[idx] += t->getAmount();
+  }
+}
+
+int BudgetSummary::realized(const Budget * budget, int year) const
+{
+  if(year < firstYear || year > lastYear)
+    return 0;
+  return realizedAmounts.value(budget).value(year - firstYear, 0);
+}
+
+int BudgetSummary::unbudgeted(int year, int month) const
+{
+  return unbudgetedAmounts.value((year - firstYear) * 12 + month - 1, 0);
+}
+
+int BudgetSummary::unbudgeted(int year) const
+{
+  if(year < firstYear || year > lastYear)
+    return 0;
+  const int * months = unbudgetedAmounts.constData() + (year - firstYear) * 12;
+  return sumAmounts(months, 12).total();
+}
+
+TransactionVector BudgetSummary::unbudgetedFor(int year, int month) const
+{
+  return unbudgetedTransactions.value((year - firstYear) * 12 + month - 1);
+}
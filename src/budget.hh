@@ -25,10 +25,11 @@
 #include <linkable.hh>
 #include <periodic.hh>
 #include <evolvingitem.hh>
+#include <transactionlists.hh>
 
 class BudgetRealization;
 class AtomicTransaction;
-class TransactionPtrList;
+class Wallet;
 
 /// This class represents a Budget.
 /// Budgets have
@@ -60,6 +61,33 @@ public:
   /// The list of realizations
   WatchableList<BudgetRealization> realizations;
 
+protected:
+
+  /// The index in realizations of the realizations, by start date of
+  /// their period. Built after loading, and then kept up-to-date as
+  /// realizationForDate() creates realizations.
+  QMap<QDate, int> startIndex;
+
+  /// The number of realizations in startIndex, or -1.
+  int indexedRealizations;
+
+  /// Whether the periods of the realizations do not overlap, in which
+  /// case the realization containing a date is necessarily the one
+  /// found in startIndex.
+  bool indexIsExact;
+
+  /// Adds the realization at index @a i to startIndex.
+  void indexRealization(int i);
+
+  /// Rebuilds startIndex from scratch.
+  void rebuildRealizationIndex();
+
+  /// Returns startIndex, after rebuilding it if realizations was
+  /// modified directly.
+  const QMap<QDate, int> & realizationIndex();
+
+public:
+
   virtual SerializationAccessor * serializationAccessor() override;
 
   virtual void finishedSerializationRead() override;
@@ -77,6 +105,10 @@ public:
   QHash<Period, BudgetRealization *> realizationsForPeriod(const Period & period,
                                                            bool create = false);
 
+  /// The total realized amount of the realizations for the given
+  /// period, see realizationsForPeriod().
+  int amountRealized(const Period & period);
+
   /// Returns all the transactions for all the budget's realizations.
   TransactionPtrList allTransactions() const;
 
@@ -93,10 +125,39 @@ public:
 /// The transactions are just stored as links, with the name
 /// "budget-realization"
 class BudgetRealization : public Linkable {
+protected:
+
+  /// @name Cache
+  ///
+  /// The transactions and their total amount, kept up-to-date by
+  /// linkAdded(), linkRemoved() and linkedAmountChanged(), so that
+  /// the links need not be resolved at every call.
+  ///
+  /// @{
+
+  mutable bool cacheValid;
+
+  mutable QList<AtomicTransaction *> cachedTransactions;
+
+  mutable int cachedRealized;
+
+  /// Fills the cache if necessary
+  void ensureCache() const;
+
+  virtual void linkAdded(Linkable * target, const QString & name) override;
+
+  virtual void linkRemoved(Linkable * target, const QString & name) override;
+
+  /// @}
+
 public:
 
   BudgetRealization();
 
+  /// To be called when the amount of one of the linked transactions
+  /// changed by @a delta.
+  void linkedAmountChanged(int delta);
+
   /// Period
   Period period;
 
@@ -127,7 +188,9 @@ public:
   /// Returns the transactions.
   TransactionPtrList transactions() const;
 
-  static TransactionPtrList realizationLessTransactions(const TransactionPtrList & lst);
+  /// Returns the transactions of the list that are not linked to any
+  /// realization.
+  static TransactionVector realizationLessTransactions(const TransactionVector & lst);
 
 };
 
@@ -143,8 +206,29 @@ public:
     int realized = 0;
   };
 
+  /// The statistics. Use addStats() rather than modifying it
+  /// directly, so that the columns below stay in sync.
   QList<PeriodStats> stats;
 
+protected:
+
+  /// @name Columns
+  ///
+  /// The contents of stats, as contiguous arrays for sumAmounts()
+  /// and sumAmountsBetween(). The days are QDate::toJulianDay().
+  ///
+  /// @{
+  QVector<int> plannedColumn;
+  QVector<int> realizedColumn;
+  QVector<int> startDays;
+  QVector<int> endDays;
+  /// @}
+
+public:
+
+  /// Adds the given statistics.
+  void addStats(const PeriodStats & stats);
+
   /// Adds the given realization to the period.
   void addRealization(const BudgetRealization * realization);
 
@@ -163,4 +247,49 @@ public:
 
 
 
+/// The realized amounts of all the budgets of a Wallet by year, and
+/// the transactions not linked to any budget by month, over a range
+/// of years.
+///
+/// Everything is computed at construction, in a single pass over the
+/// realizations of each budget and a single pass over the
+/// transactions of the range, rather than looking up each budget and
+/// month separately.
+class BudgetSummary {
+
+  int firstYear;
+
+  int lastYear;
+
+  /// Budget -> realized amount for each year of the range
+  QHash<const Budget *, QVector<int> > realizedAmounts;
+
+  /// The transactions without realization, by month of the range
+  /// (0 being January of firstYear)
+  QVector<TransactionVector> unbudgetedTransactions;
+
+  /// The total amount of unbudgetedTransactions
+  QVector<int> unbudgetedAmounts;
+
+public:
+
+  BudgetSummary(Wallet * wallet, int firstYear, int lastYear);
+
+  /// The realized amount of the budget for the year, like
+  /// Budget::amountRealized() for Period::year(): the realizations
+  /// spanning over two years count for both.
+  int realized(const Budget * budget, int year) const;
+
+  /// The total amount of the transactions of the month without
+  /// realization.
+  int unbudgeted(int year, int month) const;
+
+  /// The total amount of the transactions of the year without
+  /// realization.
+  int unbudgeted(int year) const;
+
+  /// The transactions of the month without realization.
+  TransactionVector unbudgetedFor(int year, int month) const;
+};
+
 #endif
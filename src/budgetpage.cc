@@ -154,6 +154,7 @@ QString BudgetPage::summaryTableForYear(int year)
   // Now, a summary of the realizations, for the current year
   text += tr("<table><tr><td></td>\n");
   Period cy = Period::year(year);
+  BudgetSummary summary(wallet, year, year);
 
   for(int i = 1; i <= 12; i++)
     text += tr("<th>%1 %2</th>").
@@ -167,6 +168,10 @@ QString BudgetPage::summaryTableForYear(int year)
     QList<Period> periods = rs.keys();
     // QTextStream o(stdout);
     qSort(periods);
+    QList<QDate> starts;
+    for(const Period & p : periods)
+      starts << p.startDate;
+    QVector<int> plannedAmounts = budget->amount.valuesAt(starts);
     text += "<tr><td>" +
       HTTarget::linkToTransactionDisplay(budget->name,
                                          tr("Transactions for %1").arg(budget->name),
@@ -183,14 +188,16 @@ QString BudgetPage::summaryTableForYear(int year)
       int planned, realized, effective, display;
       // o << "Period: " << p.startDate.toString()
       //   << " -> " << p.endDate.toString() << endl;
-      if(r) {
+      // Same as r->amountPlanned(), unless the realization was made
+      // with another periodicity.
+      if(r && r->period.startDate != p.startDate)
         planned = r->amountPlanned();
+      else
+        planned = plannedAmounts[i];
+      if(r)
         realized = r->amountRealized();
-      }
-      else {
-        planned = budget->amount[p.startDate];
+      else
         realized = 0;
-      }
       if(p.startDate > cd) {
         // planification
         effective = planned;
@@ -263,21 +270,19 @@ QString BudgetPage::summaryTableForYear(int year)
   text += tr("<tr><td>(unbudgeted)</td>");
 
   for(int i = 1; i <= 12; i++) {
-    Period mo = Period::month(year, i);
-    TransactionPtrList list = wallet->transactionsForPeriod(mo);
-    list = BudgetRealization::realizationLessTransactions(list);
-    TransactionListStatistics sts = list.statistics();
-    amounts[i] += sts.totalAmount;
-    amounts[0] += sts.totalAmount;
-    overallAmounts[i] += sts.totalAmount;
-    overallAmounts[0] += sts.totalAmount;
-    QString cur =  sts.totalAmount >= 0 ?
+    TransactionVector list = summary.unbudgetedFor(year, i);
+    int total = summary.unbudgeted(year, i);
+    amounts[i] += total;
+    amounts[0] += total;
+    overallAmounts[i] += total;
+    overallAmounts[0] += total;
+    QString cur =  total >= 0 ?
       "<font color='green'>%1</font>" : 
       "<b><font color='red'>%1</font></b>";
-    cur = cur.arg(Transaction::formatAmount(sts.totalAmount));
+    cur = cur.arg(Transaction::formatAmount(total));
     text += QString("<td align='center' style='padding: 1px 3px;'>%1</td>").
       arg(HTTarget::linkToTransactionDisplay(cur, tr("Unbudgeted transactions for ..."),
-                                             [list]{ return list;}));
+                                             [list]{ return list.toPtrList();}));
   }
 
   text += "<tr></tr>";
@@ -575,6 +580,9 @@ void BudgetPage::showStatistics()
   for(int y = fy; y <= ly; y++)
     displayData[y] = QHash<QString, int>();
 
+  // All the amounts, in one go
+  BudgetSummary summary(wallet, fy, ly);
+
   QString s;
   s += QString("<h3>Statistics</h3>");
   s += "\n<table>";
@@ -598,14 +606,7 @@ void BudgetPage::showStatistics()
     s += QString("<tr><td>%1</td>").
       arg(n);
     for(int y = fy; y <= ly; y++) {
-      Period p = Period::year(y);
-      int tot = 0;
-      for(BudgetRealization * r : budget->realizationsForPeriod(p).values()) {
-        if(r) {
-          for(const AtomicTransaction * t : r->transactions())
-            tot += t->getAmount();
-        }
-      }
+      int tot = summary.realized(budget, y);
       s += QString("<td align='right'>%1</td>").arg(Transaction::formatAmount(tot));
       if(! budget->exceptional) {
         totals[y] += tot;
@@ -618,11 +619,7 @@ void BudgetPage::showStatistics()
 
   s += QString("<tr><td><b>(unbudgeted)</b></td>");
   for(int y = fy; y <= ly; y++) {
-    Period p = Period::year(y);
-    int tot = 0;
-    TransactionPtrList list = wallet->transactionsForPeriod(p);
-    for(const AtomicTransaction * t : BudgetRealization::realizationLessTransactions(list))
-      tot += t->getAmount();
+    int tot = summary.unbudgeted(y);
     s += QString("<td align='right'>%1</td>").arg(Transaction::formatAmount(tot));
     displayData[y]["(uncategorized)"] = tot;
     totals[y] += tot;
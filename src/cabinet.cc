@@ -146,6 +146,9 @@ void Cabinet::finishedSerializationRead()
   // Set the cabinet linkback to the plugins
   for(int i = 0; i < plugins.size(); i++)
     plugins[i]->cabinet = this;
+
+  // The documents were read directly, without DocumentList::addDocument()
+  documents.textIndex.rescan();
 }
 
 
@@ -34,7 +34,7 @@ Categorizable::Categorizable() :
 QList<const Tag *> Categorizable::tagList() const
 {
   QList<const Tag *> rv;
-  for(Tag * t : tags)
+  for(Tag * t : tags.tags())
     rv << t;
   return rv;
 }
@@ -86,7 +86,25 @@ void Categorizable::setTagList(const QString & str, Wallet * w)
 {
   if(! w)
     w = &Cabinet::globalCabinet()->wallet;
+  QSet<Tag *> before;
+  for(Tag * t : tags.tags())
+    before.insert(t);
   tags.fromString(str, w);
+
+  for(Tag * t : tags.tags()) {
+    if(! before.remove(t))
+      tagChanged(t, true);
+  }
+  for(Tag * t : before)
+    tagChanged(t, false);
+}
+
+void Categorizable::categoryChanged(Category * /*old*/)
+{
+}
+
+void Categorizable::tagChanged(Tag * /*tag*/, bool /*set*/)
+{
 }
 
 
@@ -174,7 +192,7 @@ static void fillTags(QMenu * menu,
   t.sort();
   for(int i = 0; i < t.count(); i++) {
     QAction * a = new QAction(t[i]);
-    Tag * tag = &(*tags)[t[i]];
+    Tag * tag = tags->namedTag(t[i]);
     QObject::connect(a, &QAction::triggered, [targets, action, tag](bool) {
         for(auto t : targets)
           action(tag, t);
@@ -47,6 +47,22 @@ protected:
   /// wallet.
   void setCategoryFromNamePrivate(const QString & str);
 
+  /// @name Change notifications
+  ///
+  /// Hooks called after the categorization of the object changed, so
+  /// that derived classes can keep indices up-to-date. They do
+  /// nothing by default.
+  ///
+  /// @{
+
+  /// Called after the category changed from @a old to the current one.
+  virtual void categoryChanged(Category * old);
+
+  /// Called after the given Tag was set (@a set is true) or cleared.
+  virtual void tagChanged(Tag * tag, bool set);
+
+  /// @}
+
 public:
 
 
@@ -63,12 +79,18 @@ public:
 
   /// Clears the given tag
   void clearTag(Tag * t) {
+    if(! tags.hasTag(t))
+      return;
     tags.clearTag(t);
+    tagChanged(t, false);
   }; 
 
   /// Sets the given tag
   void setTag(Tag * t) {
+    if(tags.hasTag(t))
+      return;
     tags.setTag(t);
+    tagChanged(t, true);
   };
 
   /// Returns the list of tags
@@ -80,9 +102,14 @@ public:
 
   /// Whether the taglist contains the the given tag
   bool hasTag(const Tag * t) const {
-    return tags.hasTag(const_cast<Tag*>(t));
+    return tags.hasTag(t);
   }; 
 
+  /// Returns the tags as a TagSet
+  const TagSet & tagSet() const {
+    return tags.tagSet();
+  };
+
   /// Sets the category from the given String. If wallet is NULL, it
   /// is taken to be account->wallet, which shouldn't be NULL.
   void setCategoryFromName(const QString & str, Wallet * wallet = NULL);
@@ -98,7 +125,11 @@ public:
 
   /// sets the category.
   void setCategory(Category * c) {
+    if(c == category)
+      return;
+    Category * old = category;
     setAttribute(category, c, "category");
+    categoryChanged(old);
   };
 
   enum CategorizableColumn {
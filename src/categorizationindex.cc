@@ -0,0 +1,144 @@
+/*
+    categorizationindex.cc: inverted index of categories and tags
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <categorizationindex.hh>
+#include <wallet.hh>
+#include <transactioncursor.hh>
+
+CategorizationIndex::CategorizationIndex(Wallet * w) :
+  wallet(w), valid(false)
+{
+}
+
+void CategorizationIndex::invalidate()
+{
+  valid = false;
+  categoryPostings.clear();
+  tagPostings.clear();
+}
+
+void CategorizationIndex::rebuild()
+{
+  categoryPostings.clear();
+  tagPostings.clear();
+  for(AtomicTransaction * t : WalletCursor(wallet)) {
+    categoryPostings[t->getCategory()].insert(t);
+    for(const Tag * tag : t->tagList())
+      tagPostings[tag].insert(t);
+  }
+  valid = true;
+}
+
+void CategorizationIndex::categoryChanged(AtomicTransaction * transaction,
+                                          const Category * old)
+{
+  if(! valid)
+    return;
+  QHash<const Category *, QSet<AtomicTransaction *> >::iterator i =
+    categoryPostings.find(old);
+  if(i != categoryPostings.end()) {
+    i->remove(transaction);
+    if(i->isEmpty())
+      categoryPostings.erase(i);
+  }
+  categoryPostings[transaction->getCategory()].insert(transaction);
+}
+
+void CategorizationIndex::tagChanged(AtomicTransaction * transaction,
+                                     const Tag * tag, bool set)
+{
+  if(! valid)
+    return;
+  if(set)
+    tagPostings[tag].insert(transaction);
+  else {
+    QHash<const Tag *, QSet<AtomicTransaction *> >::iterator i =
+      tagPostings.find(tag);
+    if(i != tagPostings.end()) {
+      i->remove(transaction);
+      if(i->isEmpty())
+        tagPostings.erase(i);
+    }
+  }
+}
+
+TransactionVector CategorizationIndex::categoryTransactions(const Category * category,
+                                                             bool subCategories)
+{
+  ensureValid();
+  TransactionVector ret;
+  if(! (subCategories && category)) {
+    for(AtomicTransaction * t : categoryPostings.value(category))
+      ret << t;
+  }
+  else {
+    for(const Category * c : wallet->categories.subTree(category)) {
+      QHash<const Category *, QSet<AtomicTransaction *> >::const_iterator p =
+        categoryPostings.constFind(c);
+      if(p == categoryPostings.constEnd())
+        continue;
+      for(AtomicTransaction * t : *p)
+        ret << t;
+    }
+  }
+  ret.sortByDate();
+  return ret;
+}
+
+TransactionVector CategorizationIndex::taggedTransactions(const Tag * tag)
+{
+  ensureValid();
+  TransactionVector ret;
+  for(AtomicTransaction * t : tagPostings.value(tag))
+    ret << t;
+  ret.sortByDate();
+  return ret;
+}
+
+TransactionVector CategorizationIndex::taggedTransactions(const TagSet & required,
+                                                           const TagSet & excluded)
+{
+  ensureValid();
+  TransactionVector ret;
+
+  const QSet<AtomicTransaction *> * smallest = NULL;
+  for(int id : required.ids()) {
+    QHash<const Tag *, QSet<AtomicTransaction *> >::const_iterator i =
+      tagPostings.constFind(wallet->tags.tagForID(id));
+    if(i == tagPostings.constEnd())
+      return ret;               // Nothing has that tag
+    if((! smallest) || i->size() < smallest->size())
+      smallest = &(*i);
+  }
+
+  if(smallest) {
+    for(AtomicTransaction * t : *smallest)
+      if(t->tagSet().matches(required, excluded))
+        ret << t;
+  }
+  else {
+    // The cursor returns the transactions in chronological order
+    for(AtomicTransaction * t : WalletCursor(wallet))
+      if(! t->tagSet().intersects(excluded))
+        ret << t;
+    return ret;
+  }
+  ret.sortByDate();
+  return ret;
+}
@@ -0,0 +1,117 @@
+/**
+    \file categorizationindex.hh
+    Inverted index from categories and tags to transactions
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __CATEGORIZATIONINDEX_HH
+#define __CATEGORIZATIONINDEX_HH
+
+#include <tag.hh>
+
+class Wallet;
+class Category;
+class AtomicTransaction;
+class TransactionVector;
+
+/// This class maintains "posting lists" from the Category and Tag
+/// objects of a Wallet to the AtomicTransaction objects that refer to
+/// them, so that Wallet::categoryTransactions() and
+/// Wallet::taggedTransactions() do not have to scan all the
+/// transactions.
+///
+/// The index is built lazily on the first query, and then kept up to
+/// date through the notifications sent by Categorizable::setCategory()
+/// and friends (see AtomicTransaction::categoryChanged()). Operations
+/// that change the structure of the Wallet (import, loading, adding or
+/// removing sub-transactions) should call invalidate().
+///
+/// Sub-category queries use the interval numbering of the categories
+/// (see Category::treeIndex), so that the subtree of a Category is a
+/// contiguous range of CategoryHash::categoriesInPreOrder().
+class CategorizationIndex {
+
+  /// The wallet whose transactions are indexed
+  Wallet * wallet;
+
+  /// Whether the posting lists are up-to-date
+  bool valid;
+
+  /// Category -> transactions. The NULL key holds uncategorized
+  /// transactions.
+  QHash<const Category *, QSet<AtomicTransaction *> > categoryPostings;
+
+  /// Tag -> transactions
+  QHash<const Tag *, QSet<AtomicTransaction *> > tagPostings;
+
+  /// Rebuilds all the posting lists from scratch.
+  void rebuild();
+
+  /// Makes sure the posting lists are up-to-date
+  void ensureValid() {
+    if(! valid)
+      rebuild();
+  };
+
+public:
+
+  CategorizationIndex(Wallet * wallet);
+
+  /// Marks the whole index as stale. It will be rebuilt on the next
+  /// query.
+  void invalidate();
+
+  /// @name Notifications
+  ///
+  /// These functions are called when the categorization of an
+  /// already indexed transaction changes. They are no-ops when the
+  /// index is not built yet.
+  ///
+  /// @{
+
+  /// The Category of the transaction changed from @a old to its
+  /// current value.
+  void categoryChanged(AtomicTransaction * transaction,
+                       const Category * old);
+
+  /// The given Tag was set (if @a set is true) or cleared on the
+  /// transaction.
+  void tagChanged(AtomicTransaction * transaction,
+                  const Tag * tag, bool set);
+
+  /// @}
+
+  /// The transactions belonging to the given Category (possibly NULL
+  /// for uncategorized transactions), or to any of its descendants if
+  /// @a subCategories is true. Sorted by date.
+  TransactionVector categoryTransactions(const Category * category,
+                                          bool subCategories = true);
+
+  /// The transactions bearing the given Tag, sorted by date.
+  TransactionVector taggedTransactions(const Tag * tag);
+
+  /// The transactions bearing all the tags in @a required and none of
+  /// the ones in @a excluded, sorted by date.
+  ///
+  /// Only the postings of the least used required tag are scanned,
+  /// and the candidates are checked using their TagSet.
+  TransactionVector taggedTransactions(const TagSet & required,
+                                        const TagSet & excluded = TagSet());
+
+};
+
+#endif
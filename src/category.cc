@@ -19,11 +19,14 @@
 #include <headers.hh>
 #include <category.hh>
 
-Category::Category()
+Category::Category() :
+  treeIndex(0), treeEnd(0), treeGeneration(-1)
 {
   parent = 0;
 }
 
+int Category::currentTreeGeneration = 0;
+
 #define CategorySeparator "::"
 
 QString Category::fullName() const
@@ -92,33 +95,119 @@ SerializationAccessor * Category::serializationAccessor()
   return ac;
 }
 
-Category * CategoryHash::namedSubCategory(const QString &name, bool create)
+CategoryHash::CategoryHash()
 {
+}
 
-  int index;
-  if(name.isEmpty())
-    return NULL;
-  if(index = name.indexOf(CategorySeparator), index >= 0) {
-    QString root = name.left(index);
-    QString subPath = name.mid(index + QString(CategorySeparator).size());
-    Category * sub = namedSubCategory(root, create);
-    if(sub)
-      return sub->namedSubCategory(subPath, create);
-    else
-      return NULL;
-  }
+CategoryHash::CategoryHash(const CategoryHash & other) :
+  QHash<QString, Category>(other)
+{
+}
+
+CategoryHash & CategoryHash::operator=(const CategoryHash & other)
+{
+  QHash<QString, Category>::operator=(other);
+  pathCache.clear();
+  preOrder.clear();
+  return *this;
+}
+
+Category * CategoryHash::lookupSubCategory(const QString & name,
+                                           Category * parent,
+                                           bool create, bool * created)
+{
+  int index = name.indexOf(CategorySeparator);
+  QString root = (index >= 0 ? name.left(index) : name);
+
+  Category * cat;
+  iterator i = find(root);
+  if(i != end())
+    cat = &i.value();
   else {
-    // Plain key
-    if(contains(name))
-      return &operator[](name);
     if(!create)
       return NULL;
+    cat = &(insert(root, Category()).value());
+    cat->name = root;
+    *created = true;
+  }
+  if(! cat->parent)
+    cat->parent = parent;
 
-    insert(name, Category());
-    Category * cat = &operator[](name);
-    cat->name = name;
+  if(index < 0)
     return cat;
+  QString subPath = name.mid(index + QString(CategorySeparator).size());
+  if(subPath.isEmpty())
+    return NULL;
+  return cat->subCategories.lookupSubCategory(subPath, cat,
+                                              create, created);
+}
+
+Category * CategoryHash::namedSubCategory(const QString &name, bool create)
+{
+  if(name.isEmpty())
+    return NULL;
+  Category * cat = pathCache.value(name, NULL);
+  if(cat)
+    return cat;
+
+  bool created = false;
+  cat = lookupSubCategory(name, NULL, create, &created);
+  if(created)
+    renumber();
+  if(cat)
+    pathCache[name] = cat;
+  return cat;
+}
+
+void CategoryHash::clear()
+{
+  QHash<QString, Category>::clear();
+  pathCache.clear();
+  preOrder.clear();
+}
+
+/// Numbers the categories of the hash, starting with the current size
+/// of @a order.
+static void numberCategories(CategoryHash * hash, Category * parent,
+                             QVector<Category *> & order, int generation)
+{
+  for(CategoryHash::iterator i = hash->begin(); i != hash->end(); ++i) {
+    Category * cat = &i.value();
+    cat->parent = parent;
+    cat->treeIndex = order.size();
+    cat->treeGeneration = generation;
+    order << cat;
+    numberCategories(&cat->subCategories, cat, order, generation);
+    cat->treeEnd = order.size();
+  }
+}
+
+void CategoryHash::renumber()
+{
+  preOrder.clear();
+  numberCategories(this, NULL, preOrder, ++Category::currentTreeGeneration);
+}
+
+QVector<const Category *> CategoryHash::subTree(const Category * category)
+{
+  QVector<const Category *> ret;
+  if(! category->hasValidNumbering())
+    renumber();
+  int first = category->treeIndex;
+  if(! (category->hasValidNumbering() && first < preOrder.size() &&
+        preOrder[first] == category)) {
+    ret << category;
+    return ret;
   }
+  for(int i = first; i < category->treeEnd; i++)
+    ret << preOrder[i];
+  return ret;
+}
+
+void CategoryHash::invalidateCaches()
+{
+  pathCache.clear();
+  renumber();
 }
 
 void CategoryHash::dumpContents(QString prefix) const
@@ -135,17 +224,25 @@ void CategoryHash::dumpContents(QString prefix) const
 
 Category * Category::namedSubCategory(const QString &name, bool create)
 {
-  Category * sub = subCategories.namedSubCategory(name, create);
-  if(sub) {
-    if(! sub->parent)
-      sub->parent = this;
-  }
+  if(name.isEmpty())
+    return NULL;
+  bool created = false;
+  Category * sub = subCategories.lookupSubCategory(name, this,
+                                                   create, &created);
+  // We can't renumber from here, so we just mark the numbering stale.
+  if(created)
+    ++currentTreeGeneration;
   return sub;
 }
 
-bool Category::isChildOf(const Category * category)
+bool Category::isChildOf(const Category * category) const
 {
-  Category * c = this;
+  if(! category)
+    return false;
+  if(hasValidNumbering() && category->hasValidNumbering())
+    return category->treeIndex < treeIndex && treeIndex < category->treeEnd;
+
+  const Category * c = this;
   while(c->parent) {
     if(c->parent == category)
       return true;
@@ -26,8 +26,38 @@
 class Category;
 
 /// A hash of Category.
+///
+/// When used as the top-level hash of a category tree (such as
+/// Wallet::categories), it also caches the resolution of
+/// fully-qualified names and numbers the categories of the tree (see
+/// renumber()).
 class CategoryHash : public QHash<QString, Category> {
+
+  /// A cache of the lookups of fully-qualified names.
+  QHash<QString, Category *> pathCache;
+
+  /// All the categories of the tree, in the order of
+  /// Category::treeIndex.
+  QVector<Category *> preOrder;
+
+  friend class Category;
+
+  /// Looks up the named category, creating it (and setting
+  /// @a created to true) if @a create is true. The parent of the
+  /// categories directly in this hash is @a parent.
+  Category * lookupSubCategory(const QString & name, Category * parent,
+                               bool create, bool * created);
+
 public:
+
+  CategoryHash();
+
+  /// The caches are not copied.
+  CategoryHash(const CategoryHash & other);
+
+  /// The caches are not copied.
+  CategoryHash & operator=(const CategoryHash & other);
+
   /// Returns a pointer to the named (sub) category, or NULL if it
   /// does not exist.
   ///
@@ -35,8 +65,34 @@ public:
   /// does not exist.
   ///
   /// If name is empty, returns NULL
+  ///
+  /// Lookups are cached, and the categories renumbered when a new one
+  /// is created.
   Category * namedSubCategory(const QString &name, bool create = false);
 
+  /// Clears the hash and the caches.
+  void clear();
+
+  /// Numbers all the categories of the tree in pre-order, see
+  /// Category::treeIndex. It also makes sure that all the
+  /// Category::parent pointers are correct.
+  void renumber();
+
+  /// Clears the name cache and renumbers the categories. This must be
+  /// called after categories have been renamed, moved or removed.
+  void invalidateCaches();
+
+  /// Returns all the categories of the tree in pre-order, as of the
+  /// last renumber().
+  const QVector<Category *> & categoriesInPreOrder() const {
+    return preOrder;
+  };
+
+  /// Returns the given category followed by all its descendants,
+  /// renumbering the tree if needed. A category that does not belong
+  /// to this tree only yields itself.
+  QVector<const Category *> subTree(const Category * category);
+
   /// Dumps the contents of the hash
   void dumpContents(QString prefix = "") const;
 
@@ -82,7 +138,40 @@ public:
   Category * namedSubCategory(const QString &name, bool create = false);
 
   /// Whether this Category is a child of the given Category.
-  bool isChildOf(const Category * category);
+  ///
+  /// This is just two integer comparisons when the numbering of the
+  /// tree is up-to-date, else it walks up the parents.
+  bool isChildOf(const Category * category) const;
+
+  /// @name Tree numbering
+  ///
+  /// The categories of a tree are numbered by CategoryHash::renumber()
+  /// in a pre-order walk, so that the descendants of a Category are
+  /// exactly the ones whose treeIndex is within ]treeIndex, treeEnd[.
+  ///
+  /// @{
+
+  /// The position of the category in the pre-order walk
+  int treeIndex;
+
+  /// One past the position of the last descendant.
+  int treeEnd;
+
+  /// The numbering "generation", used to check whether treeIndex and
+  /// treeEnd are still meaningful.
+  int treeGeneration;
+
+  /// The current numbering generation. It is increased for every
+  /// renumbering, and whenever a Category is created outside of a
+  /// CategoryHash::namedSubCategory() call on the top-level hash.
+  static int currentTreeGeneration;
+
+  /// Whether the treeIndex and treeEnd are up-to-date.
+  bool hasValidNumbering() const {
+    return treeGeneration == currentTreeGeneration;
+  };
+
+  /// @}
 
 
   virtual SerializationAccessor * serializationAccessor();
@@ -34,7 +34,15 @@
 
 // for readPDF
 #include <pdftools.hh>
+
+#include <cabinet.hh>
+#include <document.hh>
+#include <documentmatcher.hh>
+#include <documentscanner.hh>
 #include <debug.hh>
+#include <amountkernels.hh>
+#include <fetchscheduler.hh>
+#include <exceptions.hh>
 
 
 void CommandLineOption::handle(QStringList & args)
@@ -186,6 +194,700 @@ static void testDocumentParsing(const QStringList & a)
   }
 }
 
+static void warmPDFCache(const QStringList & a)
+{
+  QTextStream o(stdout);
+  PDFCache * cache = PDFCache::globalCache();
+  for(const QString & dir : a) {
+    int nb = cache->warm(dir);
+    o << "Found " << nb << " PDF files in " << dir << endl;
+  }
+  o << "Cache hits: " << cache->hits
+    << ", extracted: " << cache->misses << endl;
+}
+
+static void clearPDFCache(const QStringList &)
+{
+  PDFCache::globalCache()->clear();
+}
+
+/// Matches the documents of the cabinet that are not linked to a
+/// transaction yet. The links are only created (and the cabinet
+/// saved) when @a link is true.
+static void matchDocuments(const QString & file, bool link)
+{
+  QTextStream o(stdout);
+  Cabinet cabinet;
+  cabinet.loadFromFile(file);
+
+  QList<Document *> docs;
+  for(Document * doc : cabinet.documents.allDocuments())
+    if(doc->docType() && ! doc->hasNamedLinks("document"))
+      docs << doc;
+
+  QElapsedTimer t;
+  t.start();
+  DocumentMatcher matcher(&cabinet.wallet);
+  o << "Indexed " << matcher.indexedTransactions()
+    << " transactions in " << t.restart() << " ms" << endl;
+  matcher.match(docs);
+  QList<DocumentMatcher::Suggestion> matches = matcher.matches();
+  o << "Matched " << matches.size() << " out of " << docs.size()
+    << " documents in " << t.elapsed() << " ms" << endl;
+
+  for(Document * doc : docs) {
+    QList<DocumentMatcher::Suggestion> sugs = matcher.suggestions(doc);
+    if(sugs.isEmpty())
+      continue;
+    AtomicTransaction * m = matcher.matchFor(doc);
+    o << doc->fileName() << ":" << endl;
+    for(const DocumentMatcher::Suggestion & s : sugs)
+      o << (s.transaction == m ? " * " : "   ") << s.score << "\t"
+        << s.transaction->getDate().toString("dd/MM/yyyy") << "\t"
+        << Transaction::formatAmount(s.transaction->getAmount()) << "\t"
+        << s.transaction->getName() << endl;
+  }
+
+  if(link && matches.size() > 0) {
+    for(const DocumentMatcher::Suggestion & s : matches)
+      s.transaction->addLink(s.document, "document");
+    cabinet.saveToFile(file);
+  }
+}
+
+static void showDocumentMatches(const QStringList & a)
+{
+  matchDocuments(a.first(), false);
+}
+
+static void linkDocumentMatches(const QStringList & a)
+{
+  matchDocuments(a.first(), true);
+}
+
+/// Searches the transactions and the documents of the cabinet given
+/// as first argument, using the rest of the arguments as query.
+static void searchCabinet(const QStringList & a)
+{
+  QTextStream o(stdout);
+  if(a.size() < 2) {
+    o << "Needs a cabinet file and a query" << endl;
+    return;
+  }
+  QStringList args = a;
+  Cabinet cabinet;
+  cabinet.loadFromFile(args.takeFirst());
+  QString query = args.join(" ");
+
+  QElapsedTimer t;
+  t.start();
+  TransactionVector trs = cabinet.wallet.textIndex.search(query);
+  qint64 elapsed = t.restart();
+  for(const AtomicTransaction * tr : trs)
+    o << tr->getDate().toString("dd/MM/yyyy") << "\t"
+      << Transaction::formatAmount(tr->getAmount()) << "\t"
+      << tr->getName() << "\t" << tr->getMemo() << endl;
+  o << trs.size() << " transactions found in " << elapsed << " ms" << endl;
+
+  int nb = cabinet.documents.textIndex.update();
+  o << "Indexed " << nb << " documents in " << t.restart() << " ms" << endl;
+  QList<Document *> docs = cabinet.documents.textIndex.search(query);
+  elapsed = t.elapsed();
+  for(const Document * doc : docs)
+    o << doc->fileName() << endl;
+  o << docs.size() << " documents found in " << elapsed << " ms" << endl;
+}
+
+/// Estimates the memory used by the attributes of the documents of
+/// the given cabinet.
+static void attributesMemory(const QStringList & a)
+{
+  QTextStream o(stdout);
+  Cabinet cabinet;
+  cabinet.loadFromFile(a.first());
+
+  // The header of the QString and QVariant data
+  const qint64 header = sizeof(QArrayData);
+  const qint64 node = 2 * sizeof(void*) + sizeof(QString) + sizeof(QVariant);
+
+  int docs = 0;
+  int attributes = 0;
+  qint64 hashes = 0;
+  qint64 values = 0;
+  QSet<QString> keys;
+  QSet<const QChar *> keyBuffers;
+  qint64 keyBytes = 0;
+  for(const Document * doc : cabinet.documents.allDocuments()) {
+    ++docs;
+    const AttributeHash & attrs = doc->attributes;
+    hashes += sizeof(AttributeHash) + attrs.capacity() * sizeof(void*);
+    for(AttributeHash::const_iterator i = attrs.constBegin();
+        i != attrs.constEnd(); ++i) {
+      ++attributes;
+      hashes += node;
+      keys.insert(i.key());
+      if(! keyBuffers.contains(i.key().constData())) {
+        keyBuffers.insert(i.key().constData());
+        keyBytes += header + i.key().size() * sizeof(QChar);
+      }
+      if(i.value().type() == QVariant::String)
+        values += header + i.value().toString().size() * sizeof(QChar);
+    }
+  }
+  qint64 total = hashes + keyBytes + values;
+  o << docs << " documents, " << attributes << " attributes" << endl
+    << keys.size() << " distinct keys, stored in "
+    << keyBuffers.size() << " buffers (" << keyBytes << " bytes)" << endl
+    << "Hashes: " << hashes << " bytes, string values: "
+    << values << " bytes" << endl
+    << "Total: " << total << " bytes, "
+    << (docs ? total/docs : 0) << " bytes per document" << endl;
+}
+
+/// Compares the files of the cabinet to the manifest of the last
+/// scan, renames the documents whose file was renamed and saves the
+/// cabinet if needed.
+static void scanDocuments(const QStringList & a)
+{
+  QTextStream o(stdout);
+  Cabinet cabinet;
+  cabinet.loadFromFile(a.first());
+  DocumentScanner scanner(&cabinet);
+  QObject::connect(&scanner, &DocumentScanner::filesAdded,
+                   [&o](const QStringList & files) {
+                     for(const QString & f : files)
+                       o << "New: " << f << endl;
+                   });
+  QObject::connect(&scanner, &DocumentScanner::filesRemoved,
+                   [&o](const QStringList & files) {
+                     for(const QString & f : files)
+                       o << "Removed: " << f << endl;
+                   });
+  QObject::connect(&scanner, &DocumentScanner::fileRenamed,
+                   [&o](const QString & from, const QString & to) {
+                     o << "Renamed: " << from << " -> " << to << endl;
+                   });
+  QElapsedTimer t;
+  t.start();
+  scanner.scanNow();
+  o << "Scanned in " << t.elapsed() << " ms" << endl;
+  if(cabinet.isDirty())
+    cabinet.saveToFile(a.first());
+}
+
+#ifdef WATCHDOG_STATISTICS
+/// Counts the Watchdog objects created and the connections made by
+/// the read-only queries that return a TransactionVector, first
+/// converting their results to observing TransactionPtrList objects,
+/// as they were returned before, and then as they are now.
+static void queryConnections(const QStringList & a)
+{
+  QTextStream o(stdout);
+  Cabinet cabinet;
+  cabinet.loadFromFile(a.first());
+  Wallet & wallet = cabinet.wallet;
+
+  TransactionVector all =
+    wallet.transactionsForPeriod(Period::year(1900).unite(Period::year(2100)));
+  if(all.isEmpty()) {
+    o << "No transactions" << endl;
+    return;
+  }
+  QDate first = all[0]->getDate(), last = first;
+  for(const AtomicTransaction * t : all) {
+    first = std::min(first, t->getDate());
+    last = std::max(last, t->getDate());
+  }
+
+  // The queries of the budget page and of the statistics models
+  QList<std::function<TransactionVector ()> > queries;
+  for(int y = first.year(); y <= last.year(); y++) {
+    for(int m = 1; m <= 12; m++) {
+      Period p = Period::month(y, m);
+      queries << [&wallet, p]() -> TransactionVector {
+        return wallet.transactionsForPeriod(p);
+      };
+    }
+    Period p = Period::year(y);
+    queries << [&wallet, p]() -> TransactionVector {
+      return BudgetRealization::
+        realizationLessTransactions(wallet.transactionsForPeriod(p));
+    };
+  }
+  for(const QString & n : wallet.tags.tagNames()) {
+    const Tag * tag = wallet.tags.namedTag(n);
+    queries << [&wallet, tag]() -> TransactionVector {
+      return wallet.categorizationIndex.taggedTransactions(tag);
+    };
+  }
+
+  auto measure = [&](const QString & name, bool observing) {
+    int watchdogs = Watchdog::created.load();
+    int connections = Watchdog::childConnections.load();
+    int elements = 0;
+    for(const std::function<TransactionVector ()> & q : queries) {
+      TransactionVector v = q();
+      elements += v.size();
+      // Built and thrown away, like the former query results
+      if(observing)
+        v.toPtrList();
+    }
+    o << name << ": " << queries.size() << " queries, "
+      << elements << " transactions, "
+      << Watchdog::created.load() - watchdogs << " watchdogs, "
+      << Watchdog::childConnections.load() - connections
+      << " connections" << endl;
+  };
+  measure("TransactionPtrList", true);
+  measure("TransactionVector", false);
+}
+#endif
+
+/// Times the reductions of amountkernels.hh against the plain loops
+/// they replace, on random amounts, and the statistics of transaction
+/// lists in one thread against the same split between threads.
+static void benchmarkAmounts(const QStringList &)
+{
+  QTextStream o(stdout);
+  const int n = 1 << 20;
+  const int repeats = 100;
+  QVector<int> amounts(n), days(n), categories(n);
+  QRandomGenerator random(42);
+  for(int i = 0; i < n; i++) {
+    amounts[i] = random.bounded(-100000, 100001);
+    days[i] = 2458000 + random.bounded(3650);
+    categories[i] = random.bounded(32);
+  }
+  const int * a = amounts.constData();
+  const int * d = days.constData();
+  const int * c = categories.constData();
+  const int first = 2459000, last = 2459365;
+
+  // The checksum makes sure the compiler does not skip the loops,
+  // and that both versions agree.
+  auto run = [&](const char * name, std::function<qint64 ()> scalar,
+                 std::function<qint64 ()> kernel) {
+    QElapsedTimer t;
+    qint64 s1 = 0, s2 = 0;
+    t.start();
+    for(int r = 0; r < repeats; r++)
+      s1 += scalar();
+    qint64 ts = t.nsecsElapsed();
+    t.start();
+    for(int r = 0; r < repeats; r++)
+      s2 += kernel();
+    qint64 tk = t.nsecsElapsed();
+    o << name << ": scalar " << ts/(1e6*repeats) << " ms, kernel "
+      << tk/(1e6*repeats) << " ms, speedup " << (tk > 0 ? ts*1.0/tk : 0)
+      << (s1 == s2 ? "" : " MISMATCH") << endl;
+  };
+
+  // The same branches as BasicStatistics::addAmount(), whose int
+  // totals would overflow on that many amounts.
+  run("sums", [&]() -> qint64 {
+      qint64 credit = 0, debit = 0;
+      int numberDebit = 0;
+      for(int i = 0; i < n; i++) {
+        if(a[i] < 0) {
+          debit += a[i];
+          ++numberDebit;
+        }
+        else
+          credit += a[i];
+      }
+      return credit - debit + numberDebit;
+    }, [&]() -> qint64 {
+      AmountSums s = sumAmounts(a, n);
+      return s.totalCredit - s.totalDebit + s.numberDebit;
+    });
+
+  run("date range", [&]() -> qint64 {
+      qint64 rv = 0;
+      for(int i = 0; i < n; i++)
+        if(d[i] >= first && d[i] <= last)
+          rv += a[i];
+      return rv;
+    }, [&]() -> qint64 {
+      return sumAmountsBetween(a, d, n, first, last).total();
+    });
+
+  run("category", [&]() -> qint64 {
+      qint64 rv = 0;
+      for(int i = 0; i < n; i++)
+        if(c[i] == 7)
+          rv += a[i];
+      return rv;
+    }, [&]() -> qint64 {
+      return sumAmountsOfCategory(a, c, n, 7).total();
+    });
+
+  run("extrema", [&]() -> qint64 {
+      int mn = a[0], mx = a[0];
+      for(int i = 1; i < n; i++) {
+        if(a[i] < mn)
+          mn = a[i];
+        if(a[i] > mx)
+          mx = a[i];
+      }
+      return mx - mn;
+    }, [&]() -> qint64 {
+      AmountRange r = amountRange(a, n);
+      return r.maximum - r.minimum;
+    });
+
+  // The statistics of transaction lists of growing size, computed in
+  // one thread and split into one chunk per thread, to find where
+  // TransactionPtrList::statistics() should start splitting.
+  const int maxSize = 1 << 18;
+  TransactionList transactions;
+  for(int i = 0; i < maxSize; i++) {
+    transactions << Transaction(QDate::fromJulianDay(d[i]), 0);
+    transactions[i].setAmount(a[i]);
+  }
+  transactions.sortByDate();
+  const int threads = QThread::idealThreadCount();
+  const int listRepeats = 20;
+  for(int size = 2500; size <= maxSize; size *= 2) {
+    TransactionPtrList lst;
+    for(int i = 0; i < size; i++)
+      lst.append(&transactions[i]);
+
+    QElapsedTimer t;
+    qint64 s1 = 0, s2 = 0;
+    t.start();
+    for(int r = 0; r < listRepeats; r++)
+      s1 += lst.statistics(0, size).totalAmount;
+    qint64 ts = t.nsecsElapsed();
+    t.start();
+    for(int r = 0; r < listRepeats; r++) {
+      QList<QFuture<TransactionListStatistics> > futures;
+      for(int i = 0; i < threads; i++) {
+        int begin = (size * i)/threads;
+        int end = (size * (i+1))/threads;
+        futures << QtConcurrent::run([&lst, begin, end]() {
+            return lst.statistics(begin, end);
+          });
+      }
+      TransactionListStatistics stats;
+      for(int i = 0; i < futures.size(); i++)
+        stats += futures[i].result();
+      s2 += stats.totalAmount;
+    }
+    qint64 tp = t.nsecsElapsed();
+    o << "statistics of " << size << " transactions: serial "
+      << ts/(1e6*listRepeats) << " ms, " << threads << " chunks "
+      << tp/(1e6*listRepeats) << " ms, speedup " << (tp > 0 ? ts*1.0/tp : 0)
+      << (size/TransactionPtrList::statisticsChunk > 1 ? " (split)" : "")
+      << (s1 == s2 ? "" : " MISMATCH") << endl;
+  }
+}
+
+/// The implementation of AttributeHash::formatString() before
+/// FormatTemplate, based on a QRegExp, kept as a reference for
+/// --test-format-strings.
+static QString legacyFormatString(const AttributeHash & attributes,
+                                  const QString & format)
+{
+  QString str;
+  int idx = 0;
+  int lastidx;
+  QRegExp formatSpecifierRE("%\\{([^%}]+)(%[^}]+)?\\}");
+  while(idx >= 0) {
+    lastidx = idx;
+    idx = formatSpecifierRE.indexIn(format, idx);
+    if(idx < 0)
+      str += format.mid(lastidx);
+    else {
+      str += format.mid(lastidx, idx - lastidx);
+      if(! attributes.contains(formatSpecifierRE.cap(1)))
+        str += "undef";
+      else if(formatSpecifierRE.cap(2).isEmpty())
+        str += attributes.value(formatSpecifierRE.cap(1)).toString();
+      else
+        str += AttributeHash::formatVariant(attributes.value(formatSpecifierRE.cap(1)),
+                                            formatSpecifierRE.cap(2).mid(1));
+      idx += formatSpecifierRE.cap(0).size();
+    }
+  }
+  return str;
+}
+
+/// Compares AttributeHash::formatString() and FormatTemplate with
+/// the former QRegExp-based implementation, on the infoFormat of all
+/// the document types, on the format of Transaction::transactionID()
+/// and on malformed format strings.
+static void testFormatStrings(const QStringList &)
+{
+  QTextStream o(stdout);
+  QStringList formats;
+  for(const QString & n : DocType::documentNames()) {
+    DocType * type = DocType::namedType(n);
+    if(type && ! type->infoFormat().isEmpty())
+      formats << type->infoFormat();
+  }
+  int docTypeFormats = formats.size();
+  formats << "%{date%date:dd/MM/yy}##%{amount%A}##%{memo}##%{name}"
+          << "%{a%}" << "%{%{a}" << "%{a" << "%{a%A" << "%{}"
+          << "%{a}%{b%A}%{c%M}/%{c%y}" << "100% %{a} }{ %" << "";
+
+  int failures = 0;
+  auto check = [&](const QString & what, const QString & expected,
+                   const QString & got) {
+    if(expected == got)
+      return;
+    ++failures;
+    o << "Mismatch for " << what << ":\n\texpected: '" << expected
+      << "'\n\tgot:      '" << got << "'" << endl;
+  };
+
+  // Each format is rendered with all the attributes it requires, and
+  // with none of them.
+  for(const QString & format : formats) {
+    AttributeHash full;
+    QHash<QString, AttributeHash::HandledType> required =
+      AttributeHash::requiredAttributes(format);
+    for(QHash<QString, AttributeHash::HandledType>::const_iterator i =
+          required.constBegin(); i != required.constEnd(); ++i) {
+      switch(i.value()) {
+      case AttributeHash::Number:
+        full[i.key()] = -123456;
+        break;
+      case AttributeHash::Date:
+      case AttributeHash::Time:
+        full[i.key()] = QDateTime(QDate(2020, 3, 14), QTime(15, 9, 26));
+        break;
+      default:
+        full[i.key()] = QString("Entrée %1").arg(i.key());
+      }
+    }
+    full["a"] = QString("value of a");
+    for(const AttributeHash & attributes : QList<AttributeHash>()
+          << full << AttributeHash()) {
+      QString expected = legacyFormatString(attributes, format);
+      check("formatString('" + format + "')", expected,
+            attributes.formatString(format));
+      check("FormatTemplate('" + format + "')", expected,
+            AttributeHash::FormatTemplate(format).render(attributes));
+    }
+  }
+
+  Transaction t(QDate(2020, 3, 14), 0);
+  t.setAmount(-123456);
+  check("transactionID()",
+        legacyFormatString(t.toHash(),
+                           "%{date%date:dd/MM/yy}##%{amount%A}##%{memo}##%{name}"),
+        t.transactionID());
+
+  o << formats.size() << " formats (" << docTypeFormats
+    << " from the document types) and transactionID(): "
+    << failures << " mismatches" << endl;
+  if(failures > 0)
+    throw RuntimeError("The format string test failed");
+}
+
+/// A minimal HTTP/1.1 server on the loopback interface, standing in
+/// for the web sites of the collections. On each connection, it
+/// answers the requests in order, each after a delay:
+/// @li /page/N gives "page N", followed by the data of a POST;
+/// @li /redirect/N redirects to /page/N.
+class StandInServer {
+  /// What is known about a connection
+  class Connection {
+  public:
+    QByteArray buffer;
+
+    /// The responses not sent yet
+    QQueue<QByteArray> responses;
+
+    /// Whether a response is being delayed
+    bool answering;
+
+    Connection() : answering(false) {;};
+  };
+
+  QHash<QTcpSocket *, Connection> states;
+
+  int delay;
+
+  static QByteArray respond(const QByteArray & method,
+                            const QByteArray & path,
+                            const QByteArray & data) {
+    QRegularExpression re("^/(page|redirect)/(\\d+)$");
+    QRegularExpressionMatch m = re.match(QString::fromLatin1(path));
+    if(! m.hasMatch())
+      return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    if(m.captured(1) == "redirect")
+      return "HTTP/1.1 302 Found\r\nLocation: /page/" +
+        m.captured(2).toLatin1() + "\r\nContent-Length: 0\r\n\r\n";
+    QByteArray body = "page " + m.captured(2).toLatin1();
+    if(method == "POST")
+      body += " " + data;
+    return "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " +
+      QByteArray::number(body.size()) + "\r\n\r\n" + body;
+  }
+
+  /// Parses the complete requests received on the socket.
+  void readRequests(QTcpSocket * socket) {
+    Connection & c = states[socket];
+    c.buffer += socket->readAll();
+    while(true) {
+      int end = c.buffer.indexOf("\r\n\r\n");
+      if(end < 0)
+        break;
+      QList<QByteArray> lines = c.buffer.left(end).split('\n');
+      int length = 0;
+      for(const QByteArray & l : lines.mid(1))
+        if(l.toLower().startsWith("content-length:"))
+          length = l.mid(15).trimmed().toInt();
+      if(c.buffer.size() < end + 4 + length)
+        break;
+      QList<QByteArray> first = lines[0].trimmed().split(' ');
+      c.responses.enqueue(respond(first.value(0), first.value(1),
+                                  c.buffer.mid(end + 4, length)));
+      c.buffer.remove(0, end + 4 + length);
+      ++requests;
+      ++pending;
+      maxPending = std::max(maxPending, pending);
+    }
+    if(! c.answering)
+      answerNext(socket);
+  }
+
+  void answerNext(QTcpSocket * socket) {
+    Connection & c = states[socket];
+    if(c.responses.isEmpty()) {
+      c.answering = false;
+      return;
+    }
+    c.answering = true;
+    QPointer<QTcpSocket> s(socket);
+    QTimer::singleShot(delay, [this, s]() {
+        if(! s || ! states.contains(s))
+          return;
+        s->write(states[s].responses.dequeue());
+        --pending;
+        answerNext(s);
+      });
+  }
+
+public:
+  QTcpServer server;
+
+  /// The number of connections and requests received
+  int connections;
+  int requests;
+
+  /// The number of requests received and not answered yet, and its
+  /// maximum
+  int pending;
+  int maxPending;
+
+  explicit StandInServer(int d) :
+    delay(d), connections(0), requests(0), pending(0), maxPending(0) {
+    QObject::connect(&server, &QTcpServer::newConnection, [this]() {
+        while(QTcpSocket * s = server.nextPendingConnection()) {
+          ++connections;
+          states[s] = Connection();
+          QObject::connect(s, &QTcpSocket::readyRead, [this, s]() {
+              readRequests(s);
+            });
+          QObject::connect(s, &QTcpSocket::disconnected, [this, s]() {
+              pending -= states.take(s).responses.size();
+              s->deleteLater();
+            });
+        }
+      });
+    server.listen(QHostAddress::LocalHost);
+  }
+
+  QString url(const QString & path) const {
+    return QString("http://127.0.0.1:%1%2").arg(server.serverPort()).arg(path);
+  }
+};
+
+/// Runs a batch of requests through a FetchScheduler against a
+/// StandInServer, and checks the results, the connection limit and
+/// the reuse of the connections.
+static void testFetchScheduler(const QStringList &)
+{
+  QTextStream o(stdout);
+  const int delay = 50;
+  const int nb = 24;
+  StandInServer server(delay);
+  if(! server.server.isListening())
+    throw RuntimeError("Could not start the stand-in server");
+
+  QNetworkAccessManager manager;
+  manager.setProxy(QNetworkProxy(QNetworkProxy::NoProxy));
+  FetchScheduler scheduler(&manager);
+
+  auto request = [&server](const char * path, int i) {
+    return QNetworkRequest(QUrl(server.url(QString(path).arg(i))));
+  };
+  QList<FetchScheduler::Request> requests;
+  QStringList expected;
+  int hops = 0;
+  for(int i = 0; i < nb; i++) {
+    QString page = QString("page %1").arg(i);
+    if(i % 5 == 4) {
+      QNetworkRequest r = request("/page/%1", i);
+      r.setHeader(QNetworkRequest::ContentTypeHeader,
+                  "application/x-www-form-urlencoded");
+      requests << FetchScheduler::Request(r, "x=1");
+      page += " x=1";
+    }
+    else if(i % 3 == 1) {
+      requests << FetchScheduler::Request(request("/redirect/%1", i));
+      ++hops;
+    }
+    else
+      requests << FetchScheduler::Request(request("/page/%1", i));
+    expected << page;
+  }
+
+  QEventLoop loop;
+  QStringList bodies;
+  QObject::connect(&scheduler, &FetchScheduler::batchFinished,
+                   [&](const QVector<QNetworkReply *> & replies) {
+                     for(QNetworkReply * r : replies) {
+                       bodies << QString::fromLatin1(r->readAll());
+                       r->deleteLater();
+                     }
+                     loop.quit();
+                   });
+  QTimer::singleShot(20000, &loop, &QEventLoop::quit);
+
+  QElapsedTimer t;
+  t.start();
+  scheduler.fetchAll(requests);
+  loop.exec();
+  qint64 elapsed = t.elapsed();
+
+  o << server.requests << " requests over " << server.connections
+    << " connections, at most " << server.maxPending
+    << " underway, in " << elapsed << " ms (one at a time: at least "
+    << server.requests * delay << " ms)" << endl;
+
+  QStringList failures;
+  if(bodies != expected)
+    failures << "wrong or missing results: " + bodies.join(", ");
+  if(server.requests != nb + hops)
+    failures << QString("%1 requests instead of %2").
+      arg(server.requests).arg(nb + hops);
+  if(server.maxPending > scheduler.maxConnectionsPerHost)
+    failures << QString("%1 requests underway at once, the limit is %2").
+      arg(server.maxPending).arg(scheduler.maxConnectionsPerHost);
+  if(server.maxPending < 2)
+    failures << "the requests were not run concurrently";
+  if(server.connections >= server.requests)
+    failures << "the connections were not reused";
+  for(const QString & f : failures)
+    o << "FAILED: " << f << endl;
+  if(failures.size() > 0)
+    throw RuntimeError("The fetch scheduler test failed");
+  o << "OK" << endl;
+}
+
 static void testDownload(const QStringList & a)
 {
   // QTextStream o(stdout);
@@ -319,6 +1021,30 @@ static CommandLineParser * myParser()
 			     -1, "Tries to load the given document")
     << new CommandLineOption("--test-document-parse", testDocumentParsing,
 			     -1, "Parses the PDF, do not load as document")
+    << new CommandLineOption("--warm-pdf-cache", warmPDFCache,
+			     -1, "Extracts the text of all the PDF files in the given directories into the cache")
+    << new CommandLineOption("--clear-pdf-cache", clearPDFCache,
+			     0, "Removes all the extracted PDF text from the cache")
+    << new CommandLineOption("--match-documents", showDocumentMatches,
+			     1, "Lists the transactions matching the unlinked documents of the given cabinet")
+    << new CommandLineOption("--link-documents", linkDocumentMatches,
+			     1, "Links the unlinked documents of the given cabinet to their matching transaction, and saves it")
+    << new CommandLineOption("--search", searchCabinet,
+			     -1, "Searches the transactions and documents of the given cabinet")
+    << new CommandLineOption("--attributes-memory", attributesMemory,
+			     1, "Estimates the memory used by the attributes of the documents of the given cabinet")
+    << new CommandLineOption("--scan-documents", scanDocuments,
+			     1, "Looks for the files added, removed or renamed in the directory of the given cabinet")
+#ifdef WATCHDOG_STATISTICS
+    << new CommandLineOption("--query-connections", queryConnections,
+			     1, "Counts the connections made by the read-only queries on the given cabinet")
+#endif
+    << new CommandLineOption("--benchmark-amounts", benchmarkAmounts,
+			     0, "Compares the speed of the amount reductions with plain loops, and of serial and parallel statistics")
+    << new CommandLineOption("--test-format-strings", testFormatStrings,
+			     0, "Compares the rendering of format strings with the former implementation")
+    << new CommandLineOption("--test-fetch-scheduler", testFetchScheduler,
+			     0, "Runs concurrent requests against a local stand-in HTTP server")
     << new CommandLineOption("--test-download", testDownload,
 			     -1, "Attempts to download new documents")
     << new CommandLineOption("--test-xml", testXML,
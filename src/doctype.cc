@@ -31,6 +31,10 @@ QHash<QString, DocType*> DocType::namedTypes;
 
 QQmlEngine * DocType::engine;
 
+QStringList DocType::typeFiles;
+
+thread_local QHash<QString, DocType*> * DocType::registry = NULL;
+
 DocType::DocType(QObject * parent) : QObject(parent),
                                      parent(NULL), collection(NULL),
                                      daysBefore(10), daysAfter(20)
@@ -68,13 +72,14 @@ void DocType::setName(const QString & n)
   if(m_Name == n)
     return;
   m_Name = n;
-  if(namedTypes.contains(m_Name)) {
+  QHash<QString, DocType*> & types = registry ? *registry : namedTypes;
+  if(types.contains(m_Name)) {
     /// @todo Logging !
     QTextStream o(stderr);
     o << "Redefining doc type '" << m_Name << "'" << endl;
-    delete namedTypes.take(m_Name);
+    delete types.take(m_Name);
   }
-  namedTypes[m_Name] = this;
+  types[m_Name] = this;
 }
 
 QString DocType::description() const
@@ -110,6 +115,42 @@ void DocType::setParentName(const QString & n)
   m_ParentName = n;
 }
 
+QStringList DocType::keywords() const
+{
+  return m_Keywords;
+}
+
+void DocType::setKeywords(const QStringList & n)
+{
+  m_Keywords = n;
+}
+
+QStringList DocType::patterns() const
+{
+  return m_Patterns;
+}
+
+void DocType::setPatterns(const QStringList & n)
+{
+  m_Patterns = n;
+  compiledPatterns.clear();
+  for(const QString & p : m_Patterns)
+    compiledPatterns << QRegularExpression(p);
+}
+
+bool DocType::mayBeMine(const QString & text) const
+{
+  if(m_Keywords.isEmpty() && compiledPatterns.isEmpty())
+    return true;
+  for(const QString & k : m_Keywords)
+    if(text.contains(k, Qt::CaseInsensitive))
+      return true;
+  for(const QRegularExpression & re : compiledPatterns)
+    if(re.match(text).hasMatch())
+      return true;
+  return false;
+}
+
 QStringList DocType::dateFields() const
 {
   return m_Dates;
@@ -158,20 +199,25 @@ void DocType::setAmountFields(const QStringList & n)
 }
 
 
-void DocType::parseQMLFile(const QString & file)
+QObject * DocType::loadQMLFile(QQmlEngine * eng, const QString & file)
 {
-  if(! engine)
-    engine = new QQmlEngine;
-  QQmlComponent component(engine, QUrl::fromLocalFile(file));
+  QQmlComponent component(eng, QUrl::fromLocalFile(file));
   if(component.isError()) {
     QList<QQmlError> errs = component.errors();
     QTextStream o(stdout);
     for(int i = 0; i < errs.size();i++)
       o << errs[i].toString() << endl;
+    return NULL;
   }
-  else {
-    component.create();
-  }
+  return component.create();
+}
+
+void DocType::parseQMLFile(const QString & file)
+{
+  if(! engine)
+    engine = new QQmlEngine;
+  if(loadQMLFile(engine, file))
+    typeFiles << file;
 }
 
 DocType * DocType::namedType(const QString & name)
@@ -181,13 +227,65 @@ DocType * DocType::namedType(const QString & name)
 
 void DocType::crosslinkTypes()
 {
-  for(auto i : namedTypes) {
+  crosslinkTypes(namedTypes);
+}
+
+void DocType::crosslinkTypes(const QHash<QString, DocType*> & types)
+{
+  for(auto i : types) {
     if(! i->m_ParentName.isEmpty()) {
-      i->parent = namedType(i->m_ParentName);
+      i->parent = types.value(i->m_ParentName, NULL);
     }
   }
 }
 
+/// The copies of the DocType objects for a thread other than the one
+/// of the main QQmlEngine.
+class ThreadDocTypes {
+public:
+  QQmlEngine engine;
+
+  /// The objects created from the files
+  QList<QObject *> roots;
+
+  QHash<QString, DocType*> types;
+
+  explicit ThreadDocTypes(const QStringList & files) {
+    DocType::registry = &types;
+    for(const QString & f : files) {
+      QObject * o = DocType::loadQMLFile(&engine, f);
+      if(o)
+        roots << o;
+    }
+    DocType::registry = NULL;
+    DocType::crosslinkTypes(types);
+  };
+
+  ~ThreadDocTypes() {
+    for(QObject * o : roots)
+      delete o;
+  };
+};
+
+const QHash<QString, DocType*> & DocType::typesForCurrentThread()
+{
+  if((! engine) || QThread::currentThread() == engine->thread())
+    return namedTypes;
+
+  static QThreadStorage<ThreadDocTypes *> threadTypes;
+  if(! threadTypes.hasLocalData()) {
+    threadTypes.setLocalData(new ThreadDocTypes(typeFiles));
+  }
+  return threadTypes.localData()->types;
+}
+
+DocType * DocType::threadInstance()
+{
+  if(QThread::currentThread() == thread())
+    return this;
+  return typesForCurrentThread().value(m_Name, this);
+}
+
 QHash<QString, AttributeHash::HandledType> DocType::requiredAttributes()
 {
   QHash<QString, AttributeHash::HandledType> rv;
@@ -230,20 +328,31 @@ bool DocType::hasIsMine() const
   return metaObject()->indexOfMethod("isMine(QVariant)") >= 0;
 }
 
-int DocType::isMine(const AttributeHash & attrs)
+QVariant DocType::invokeScript(const char * signature, const QVariant & arg)
 {
-  const QMetaObject * mo = metaObject();
-  int idx = mo->indexOfMethod("isMine(QVariant)");
+  DocType * target = threadInstance();
+  const QMetaObject * mo = target->metaObject();
+  int idx = mo->indexOfMethod(signature);
   if(idx < 0)
-    return 0;
+    return QVariant();
   QMetaMethod met = mo->method(idx);
-  QVariant rv = 0;
-  QVariant v = attrs.toScript();
-  bool r = met.invoke(this,
-             Qt::DirectConnection,
+  QVariant rv;
+  met.invoke(target, Qt::DirectConnection,
              Q_RETURN_ARG(QVariant, rv),
-             Q_ARG(QVariant, v));
-  return rv.toInt();
+             Q_ARG(QVariant, arg));
+  return rv;
+}
+
+int DocType::isMine(const AttributeHash & attrs)
+{
+  if(! hasIsMine())
+    return 0;
+  return isMine(attrs.toScript());
+}
+
+int DocType::isMine(const QVariant & scriptContents)
+{
+  return invokeScript("isMine(QVariant)", scriptContents).toInt();
 }
 
 bool DocType::hasParseMetaData() const
@@ -253,37 +362,49 @@ bool DocType::hasParseMetaData() const
 
 DocType * DocType::autoDetectType(const AttributeHash & contents)
 {
+  const QHash<QString, DocType*> & types = typesForCurrentThread();
+  QString text = contents.value("text").toString() + "\n" +
+    contents.value("text-layout").toString();
+
+  // The conversion of the whole contents is expensive, it is only
+  // done once, and only if a type needs it.
+  QVariant script;
+  bool converted = false;
+
   int max = 0;
   DocType * cur = NULL;
-  QTextStream o(stdout);
-  for(DocType * dt : namedTypes.values()) {
-    o << "DocType: " << dt->m_Name << endl;
-    if(dt->hasIsMine()) {
-      int nb = dt->isMine(contents);
-      if(nb > max) {
-        max = nb;
-        cur = dt;
-      }
-      o << " -> isMine: " << nb << endl;
+  QStringList names = types.keys();
+  names.sort();                 // So that ties are resolved the same
+                                // way in all threads
+  for(const QString & n : names) {
+    DocType * dt = types[n];
+    if(! (dt->hasIsMine() && dt->mayBeMine(text)))
+      continue;
+    if(! converted) {
+      script = contents.toScript();
+      converted = true;
+    }
+    int nb = dt->isMine(script);
+    if(nb > max) {
+      max = nb;
+      cur = dt;
     }
   }
-  return cur;
+  // Always return the objects of the main thread
+  return cur ? namedType(cur->m_Name) : NULL;
 }
 
 AttributeHash DocType::parseMetaData(const AttributeHash & contents)
 {
-  const QMetaObject * mo = metaObject();
-  int idx = mo->indexOfMethod("parseMetaData(QVariant)");
-  if(idx < 0)
+  if(! hasParseMetaData())
     return AttributeHash();
-  QMetaMethod met = mo->method(idx);
-  QVariant rv = 0;
-  QVariant v = contents.toScript();
-  bool r = met.invoke(this,
-             Qt::DirectConnection,
-             Q_RETURN_ARG(QVariant, rv),
-             Q_ARG(QVariant, v));
-  return AttributeHash::fromScript(rv);
+  return parseMetaData(contents.toScript());
+}
+
+AttributeHash DocType::parseMetaData(const QVariant & scriptContents)
+{
+  return AttributeHash::fromScript(invokeScript("parseMetaData(QVariant)",
+                                                scriptContents));
 }
 
 
@@ -328,12 +449,11 @@ int DocType::scoreForTransaction(const Document * doc,
   if(! p.isValid())
     return 0;
 
-  for(const QString & n : allAmountFields()) {
-    if(doc->attributes.contains(n) &&
-       doc->attributes[n].canConvert(QMetaType::Int)) {
-      int amount = doc->attributes[n].toInt();
-      if(amount == tr->getAmount() || amount + tr->getAmount() == 0)
-        return 100;
+  for(int amount : amounts(doc)) {
+    if(amount == tr->getAmount() || amount + tr->getAmount() == 0) {
+      // Closer transactions are better matches
+      int dist = abs(referenceDate(doc).daysTo(tr->getDate()));
+      return std::max(100 - dist, 1);
     }
   }
   return 0;
@@ -342,14 +462,32 @@ int DocType::scoreForTransaction(const Document * doc,
 Period DocType::relevantDateRange(const Document * doc) const
 {
   /// @todo Delegate that to the type if the correct function exists.
-  
+  QDate date = referenceDate(doc);
+  if(! date.isValid())
+    return Period();
+  return Period(date, daysBefore, daysAfter);
+}
+
+QDate DocType::referenceDate(const Document * doc) const
+{
   // We look for the first date available date in dateFields)
   for(const QString & n : allDateFields()) {
     if(doc->attributes.contains(n) &&
        doc->attributes[n].canConvert(QMetaType::QDate))
-      return Period(doc->attributes[n].toDate(), daysBefore, daysAfter);
+      return doc->attributes[n].toDate();
   }
-  return Period();
+  return QDate();
+}
+
+QList<int> DocType::amounts(const Document * doc) const
+{
+  QList<int> rv;
+  for(const QString & n : allAmountFields()) {
+    if(doc->attributes.contains(n) &&
+       doc->attributes[n].canConvert(QMetaType::Int))
+      rv << doc->attributes[n].toInt();
+  }
+  return rv;
 }
 
 
@@ -38,6 +38,33 @@ class DocType : public QObject {
 
   static QQmlEngine * engine;
 
+  /// The files loaded by loadTypes(), so that the same types can be
+  /// loaded again in the QQmlEngine of other threads.
+  static QStringList typeFiles;
+
+  /// Where setName() registers the new types: namedTypes, unless the
+  /// types for another thread are being loaded.
+  static thread_local QHash<QString, DocType*> * registry;
+
+  /// Loads the given file into the given engine, and returns the
+  /// object created.
+  static QObject * loadQMLFile(QQmlEngine * engine, const QString & file);
+
+  /// Sets the parent of all the types of the hash.
+  static void crosslinkTypes(const QHash<QString, DocType*> & types);
+
+  /// The DocType objects for the current thread: namedTypes in the
+  /// thread of the main engine, and copies loaded into an engine of
+  /// their own in the other threads.
+  static const QHash<QString, DocType*> & typesForCurrentThread();
+
+  /// Returns the object with the same name that can be used in the
+  /// current thread (most of the times, this).
+  DocType * threadInstance();
+
+  /// Calls the named JS function with the given argument
+  QVariant invokeScript(const char * signature, const QVariant & arg);
+
   Q_PROPERTY(QString name READ name WRITE setName)
 
   /// The name of the type 
@@ -80,7 +107,22 @@ class DocType : public QObject {
   /// The parent document.
   DocType * parent;
 
+  Q_PROPERTY(QStringList keywords READ keywords WRITE setKeywords)
+
+  /// Words of which the text of a document must contain at least one
+  /// (regardless of the case) for isMine() to be called at all.
+  QStringList m_Keywords;
+
+  Q_PROPERTY(QStringList patterns READ patterns WRITE setPatterns)
+
+  /// Same as m_Keywords, but with regular expressions
+  QStringList m_Patterns;
+
+  /// The compiled m_Patterns
+  QList<QRegularExpression> compiledPatterns;
+
   friend class Collection;
+  friend class ThreadDocTypes;
 
   /// The underlying collection.
   Collection * collection;
@@ -121,6 +163,18 @@ public:
   QString parentName() const;
   void setParentName(const QString & name);
 
+  QStringList keywords() const;
+  void setKeywords(const QStringList & kw);
+
+  QStringList patterns() const;
+  void setPatterns(const QStringList & pt);
+
+  /// Returns false if the keywords and patterns show that a document
+  /// with the given text cannot be of this type, in which case there
+  /// is no need to call isMine(). Always true when there are neither
+  /// keywords nor patterns.
+  bool mayBeMine(const QString & text) const;
+
 
   /// Returns the attributes required by the DocType
   QHash<QString, AttributeHash::HandledType> requiredAttributes();
@@ -163,6 +217,11 @@ public:
   /// Returns 0 if the document does not support detection.
   int isMine(const AttributeHash & contents);
 
+  /// Same as above, with contents already converted using
+  /// AttributeHash::toScript(). Cheaper when the same contents are
+  /// given to several types.
+  int isMine(const QVariant & scriptContents);
+
   /// Returns true if the DocType has a parseMetaData function declaration.
   bool hasParseMetaData() const;
 
@@ -173,13 +232,22 @@ public:
   /// Returns 0 if the document does not support detection.
   AttributeHash parseMetaData(const AttributeHash & contents);
 
+  /// Same as above, with contents already converted using
+  /// AttributeHash::toScript().
+  AttributeHash parseMetaData(const QVariant & scriptContents);
+
 
   /// @}
 
   /// Attempts autodetection of the document type, by passing @a
-  /// contents to isMine() of all the document types that have them.
+  /// contents to isMine() of all the document types that have them,
+  /// and whose keywords and patterns match the text (see mayBeMine()).
   ///
   /// Returns the DocType found, or NULL if none was found.
+  ///
+  /// This function, as well as isMine() and parseMetaData(), can be
+  /// called from any thread: threads other than the main one get
+  /// their own QQmlEngine, in which the types are loaded again.
   static DocType * autoDetectType(const AttributeHash & contents);
 
 
@@ -207,6 +275,13 @@ public:
   /// Returns the date range in which a matching transaction could be
   /// found.
   Period relevantDateRange(const Document * doc) const;
+
+  /// The date of the document, i.e. the value of the first date field
+  /// available, or an invalid date.
+  QDate referenceDate(const Document * doc) const;
+
+  /// The values of all the amount fields available in the document.
+  QList<int> amounts(const Document * doc) const;
   /// @}
 
   /// @name Helper for DocType JS code
@@ -141,3 +141,35 @@ Period Document::relevantDateRange() const
     return Period();
   return m_DocType->relevantDateRange(this);
 }
+
+QDate Document::referenceDate() const
+{
+  if(! m_DocType)
+    return QDate();
+  return m_DocType->referenceDate(this);
+}
+
+QList<int> Document::amounts() const
+{
+  if(! m_DocType)
+    return QList<int>();
+  return m_DocType->amounts(this);
+}
+
+AtomicTransaction * Document::findMatchingTransaction(Wallet * wallet) const
+{
+  Period p = relevantDateRange();
+  if(! p.isValid())
+    return NULL;
+  TransactionVector trs = wallet->transactionsForPeriod(p);
+  AtomicTransaction * rv = NULL;
+  int score = 0;
+  for(AtomicTransaction * t : trs) {
+    int s = scoreForTransaction(t);
+    if(s > score) {
+      score = s;
+      rv = t;
+    }
+  }
+  return rv;
+}
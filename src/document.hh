@@ -29,6 +29,7 @@
 class DocType;
 class AtomicTransaction;
 class Period;
+class Wallet;
 
 /// This class represents a single document.
 class Document : public Linkable, public Categorizable {
@@ -116,6 +117,12 @@ public:
   /// @{
   int scoreForTransaction(AtomicTransaction * tr) const;
   Period relevantDateRange() const;
+  QDate referenceDate() const;
+  QList<int> amounts() const;
+
+  /// Returns the transaction of the wallet with the best score, or
+  /// NULL if none matches.
+  AtomicTransaction * findMatchingTransaction(Wallet * wallet) const;
   /// @}
 
   
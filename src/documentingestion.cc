@@ -0,0 +1,257 @@
+/*
+    documentingestion.cc: pipelined processing of many new documents
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <documentingestion.hh>
+#include <boundedqueue.hh>
+
+#include <cabinet.hh>
+#include <document.hh>
+#include <doctype.hh>
+#include <pdftools.hh>
+#include <documentmatcher.hh>
+#include <transactioncursor.hh>
+
+#include <memory>
+
+DocumentIngestion::DocumentIngestion(Cabinet * c) :
+  cabinet(c), elapsed(0),
+  extractionThreads(QThread::idealThreadCount()),
+  queueSize(16), matchTransactions(true)
+{
+}
+
+DocumentIngestion::~DocumentIngestion()
+{
+  for(const Result & r : results)
+    delete r.document;
+}
+
+QStringList DocumentIngestion::newFiles(const QString & directory) const
+{
+  QStringList rv;
+  QDir base = cabinet->baseDirectory();
+  QDirIterator it(base.absoluteFilePath(directory),
+                  QStringList() << "*.pdf", QDir::Files,
+                  QDirIterator::Subdirectories);
+  while(it.hasNext()) {
+    QString file = base.relativeFilePath(it.next());
+    if(! cabinet->documents.document(file))
+      rv << file;
+  }
+  rv.sort();
+  return rv;
+}
+
+/// The output of the extraction and detection stages
+class ExtractedContents {
+public:
+  /// The index of the file
+  int index;
+
+  /// The type detected, or NULL
+  DocType * type;
+
+  /// The meta-data found by DocType::parseMetaData()
+  AttributeHash metaData;
+};
+
+void DocumentIngestion::process(const QStringList & files)
+{
+  QElapsedTimer total;
+  total.start();
+
+  StageStatistics extraction, detection, parsing, matching;
+  extraction.name = "extraction";
+  detection.name = "type detection";
+  parsing.name = "meta-data parsing";
+  matching.name = "transaction matching";
+
+  QDir base = cabinet->baseDirectory();
+  QStringList paths;
+  for(const QString & f : files)
+    paths << base.absoluteFilePath(f);
+
+  int threads = std::max(1, std::min(extractionThreads, paths.size()));
+  BoundedQueue<ExtractedContents> extracted(queueSize, threads);
+  BoundedQueue<Result> detected(queueSize);
+
+  // One more thread for the matching stage
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads + 1);
+
+  // The index of the transactions is built before the workers start,
+  // so that the matching thread only reads the matcher.
+  QElapsedTimer t;
+  t.start();
+  std::unique_ptr<DocumentMatcher> matcher;
+  if(matchTransactions)
+    matcher.reset(new DocumentMatcher(&cabinet->wallet));
+  matching.busy += t.elapsed();
+
+  // Extraction, detection and parsing: each worker takes the next
+  // file not processed yet. The DocType objects used in the workers
+  // live in a QQmlEngine of their own (see DocType::autoDetectType()).
+  QAtomicInt next(0);
+  QAtomicInt cancelled(0);
+  QMutex statisticsMutex;
+  for(int i = 0; i < threads; i++) {
+    QtConcurrent::run(&pool, [&]() {
+        while(! cancelled.loadAcquire()) {
+          int idx = next.fetchAndAddOrdered(1);
+          if(idx >= paths.size())
+            break;
+          QElapsedTimer t;
+          t.start();
+          ExtractedContents e;
+          e.index = idx;
+          AttributeHash contents = PDFTools::readPDF(paths[idx]);
+          qint64 extractionTime = t.restart();
+
+          e.type = DocType::autoDetectType(contents);
+          qint64 detectionTime = t.restart();
+
+          qint64 parsingTime = -1;
+          if(e.type && e.type->hasParseMetaData()) {
+            e.metaData = e.type->parseMetaData(contents);
+            parsingTime = t.elapsed();
+          }
+          {
+            QMutexLocker l(&statisticsMutex);
+            ++extraction.items;
+            extraction.busy += extractionTime;
+            ++detection.items;
+            detection.busy += detectionTime;
+            if(parsingTime >= 0) {
+              ++parsing.items;
+              parsing.busy += parsingTime;
+            }
+          }
+          extracted.push(e);
+        }
+        extracted.producerDone();
+      });
+  }
+
+  // Matching: only reads the wallet, which is not modified until
+  // commit(). The transactions are assigned once all the documents
+  // are known, so that two documents never get the same one.
+  QList<Result> done;
+  if(matchTransactions) {
+    QtConcurrent::run(&pool, [&]() {
+        QElapsedTimer t;
+        Result r;
+        while(detected.pop(&r)) {
+          t.start();
+          matcher->addDocument(r.document);
+          ++matching.items;
+          matching.busy += t.elapsed();
+          done << r;
+        }
+        t.start();
+        matcher->resolve();
+        for(Result & d : done)
+          d.transaction = matcher->matchFor(d.document);
+        matching.busy += t.elapsed();
+      });
+  }
+
+  // Creation of the documents, in this thread, since they are
+  // Watchable objects. The queue is polled, so that the progress
+  // callback can keep the interface alive.
+  ExtractedContents e;
+  int created = 0;
+  while(true) {
+    BoundedQueue<ExtractedContents>::PopResult pr =
+      extracted.tryPop(&e, 50);
+    if(pr == BoundedQueue<ExtractedContents>::Finished)
+      break;
+    if(progress && ! progress(created, paths.size()))
+      cancelled.storeRelease(1);
+    if(pr == BoundedQueue<ExtractedContents>::TimedOut)
+      continue;
+    ++created;
+    Result r;
+    r.document = new Document(files[e.index]);
+    r.transaction = NULL;
+    if(e.type) {
+      r.document->setDocType(e.type);
+      r.document->attributes.unite(e.metaData);
+    }
+
+    if(matchTransactions)
+      detected.push(r);
+    else
+      done << r;
+  }
+  detected.producerDone();
+  while(! pool.waitForDone(50)) {
+    if(progress)
+      progress(created, paths.size());
+  }
+  PDFCache::globalCache()->flush();
+
+  results += done;
+  stages.clear();
+  stages << extraction << detection << parsing;
+  if(matchTransactions)
+    stages << matching;
+  elapsed = total.elapsed();
+}
+
+int DocumentIngestion::commit()
+{
+  // The matches were found on the wallet as it was during process().
+  // Only the transactions still in the wallet, and still without a
+  // document, get linked.
+  QSet<const AtomicTransaction *> present;
+  for(const Result & r : results) {
+    if(r.transaction) {
+      for(const AtomicTransaction * t : WalletCursor(&cabinet->wallet))
+        present.insert(t);
+      break;
+    }
+  }
+
+  int nb = 0;
+  for(const Result & r : results) {
+    if(cabinet->documents.document(r.document->fileName())) {
+      // Added in the meantime
+      delete r.document;
+      continue;
+    }
+    cabinet->documents.addDocument(r.document);
+    if(r.transaction && present.contains(r.transaction) &&
+       ! r.transaction->hasNamedLinks("document"))
+      r.transaction->addLink(r.document, "document");
+    ++nb;
+  }
+  results.clear();
+  return nb;
+}
+
+QString DocumentIngestion::report() const
+{
+  QString rv;
+  for(const StageStatistics & s : stages)
+    rv += QString("%1: %2 documents in %3 s (%4 documents/s)\n").
+      arg(s.name).arg(s.items).arg(s.busy/1000.0).
+      arg(s.throughput(), 0, 'f', 1);
+  rv += QString("Total: %1 s\n").arg(elapsed/1000.0);
+  return rv;
+}
@@ -0,0 +1,150 @@
+/**
+    \file documentingestion.hh
+    Pipelined processing of many new documents at once
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __DOCUMENTINGESTION_HH
+#define __DOCUMENTINGESTION_HH
+
+class Cabinet;
+class Document;
+class AtomicTransaction;
+
+/// Adds many new documents to a Cabinet, going through the same steps
+/// as Document::autoDetectDocType() followed by a search for a
+/// matching transaction, but with the stages running concurrently:
+///
+/// @li the text extraction, the type detection and the parsing of the
+/// meta-data, on a pool of threads (each using its own Poppler
+/// document, see PDFTools::readPDF(), and its own QQmlEngine, see
+/// DocType::autoDetectType());
+/// @li the creation of the Document objects, on the calling thread;
+/// @li the matching against the transactions of the Wallet, on
+/// another thread.
+///
+/// The stages are connected by BoundedQueue objects, so that at most
+/// queueSize documents are waiting between two stages. Nothing is
+/// added to the Cabinet until commit() is called, which must be done
+/// from the GUI thread.
+///
+/// Since the Document objects are Watchable, process() must run in
+/// the GUI thread too. It keeps the interface alive through the
+/// progress callback, which is called regularly while the other
+/// stages run. The matching thread reads the transactions of the
+/// Wallet during the whole of process(), so the caller must make sure
+/// nothing modifies the Wallet or the DocumentList meanwhile (using a
+/// modal dialog, and DocumentScanner::pause()).
+class DocumentIngestion {
+public:
+
+  /// The work done by one stage of the pipeline
+  class StageStatistics {
+  public:
+    QString name;
+
+    /// The number of documents processed
+    int items = 0;
+
+    /// The total time spent processing them, in milliseconds (summed
+    /// over the threads)
+    qint64 busy = 0;
+
+    /// The number of documents per second of processing time.
+    double throughput() const {
+      return busy > 0 ? items * 1000.0 / busy : 0;
+    };
+  };
+
+  /// The outcome for one document
+  class Result {
+  public:
+    Document * document;
+
+    /// The matching transaction, or NULL
+    AtomicTransaction * transaction;
+  };
+
+protected:
+
+  Cabinet * cabinet;
+
+  /// The processed documents, not committed yet
+  QList<Result> results;
+
+  /// The statistics of each stage
+  QList<StageStatistics> stages;
+
+  /// The total time of the last run of process(), in milliseconds
+  qint64 elapsed;
+
+public:
+
+  explicit DocumentIngestion(Cabinet * cabinet);
+
+  /// Deletes the documents that were not committed.
+  ~DocumentIngestion();
+
+  /// The number of threads for the extraction and detection stages
+  /// (defaults to QThread::idealThreadCount()).
+  int extractionThreads;
+
+  /// The maximum number of documents waiting between two stages
+  int queueSize;
+
+  /// Whether the matching stage is run.
+  bool matchTransactions;
+
+  /// If set, called from the thread running process() at least every
+  /// 50 milliseconds, with the number of documents created so far and
+  /// the total number of files. Returning false cancels the
+  /// processing of the files not started yet; the ones already
+  /// processed are kept.
+  std::function<bool (int done, int total)> progress;
+
+  /// Returns the files (relative to Cabinet::baseDirectory()) of the
+  /// PDF documents in the given directory and its subdirectories that
+  /// are not in the DocumentList of the cabinet yet.
+  QStringList newFiles(const QString & directory) const;
+
+  /// Processes the given files, whose names are relative to
+  /// Cabinet::baseDirectory(). Blocks until all the stages are done.
+  void process(const QStringList & files);
+
+  /// The results of process()
+  const QList<Result> & processed() const {
+    return results;
+  };
+
+  /// Adds all the processed documents to the DocumentList of the
+  /// cabinet, and links them to their matching transaction, if any.
+  /// The documents added to the cabinet since process() are skipped,
+  /// and so are the matches with transactions that were removed or
+  /// that got a document in the meantime. Returns the number of
+  /// documents added.
+  int commit();
+
+  /// The statistics of the last run of process().
+  const QList<StageStatistics> & stageStatistics() const {
+    return stages;
+  };
+
+  /// A small text describing the throughput of each stage.
+  QString report() const;
+};
+
+#endif
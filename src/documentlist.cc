@@ -22,7 +22,7 @@
 #include <document.hh>
 
 
-DocumentList::DocumentList()
+DocumentList::DocumentList() : textIndex(this)
 {
 }
 
@@ -63,6 +63,8 @@ bool DocumentList::renameDocument(Document * doc, const QString & newName)
   if(doc->rename(newName)) {
     documents.remove(on);
     documents[doc->fileName()] = doc;
+    textIndex.documentRemoved(on);
+    textIndex.documentChanged(doc);
     return true;
   }
   return false;
@@ -76,6 +78,26 @@ void DocumentList::addDocument(Document * doc)
   if(documents.contains(fn))
     throw "Not replacing";
   documents[fn] = doc;
+  textIndex.documentChanged(doc);
+}
+
+void DocumentList::renamePath(const QString & oldPath,
+                              const QString & newPath)
+{
+  QString dir = oldPath + "/";
+  QList<Document *> moved;
+  for(Document * doc : documents)
+    if(doc->m_FileName == oldPath || doc->m_FileName.startsWith(dir))
+      moved << doc;
+  for(Document * doc : moved) {
+    documents.remove(doc->m_FileName);
+    textIndex.documentRemoved(doc->m_FileName);
+  }
+  for(Document * doc : moved) {
+    doc->m_FileName = newPath + doc->m_FileName.mid(oldPath.size());
+    documents[doc->m_FileName] = doc;
+    textIndex.documentChanged(doc);
+  }
 }
 
 QList<Document *> DocumentList::allDocuments() const
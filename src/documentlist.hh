@@ -22,6 +22,7 @@
 #define __DOCUMENTLIST_HH
 
 #include <serializable.hh>
+#include <textindex.hh>
 
 class Document;
 
@@ -30,6 +31,7 @@ class Document;
 /// It provides facilities for:
 /// @li finding a document by file name
 /// @li renaming files and directories
+/// @li full-text search (see textIndex)
 ///
 /// @todo Make non-owning version. Or use std::unique ?
 class DocumentList : public Serializable {
@@ -58,10 +60,16 @@ public:
   /// Returns the list of all the documents
   QList<Document*> allDocuments() const;
 
+  /// The full-text index of the documents
+  DocumentTextIndex textIndex;
+
   /// Renames the given document.
   bool renameDocument(Document * doc, const QString & newName);
 
   /// Renames the given path. Makes the right thing about directories.
+  ///
+  /// Only the documents are updated: the files must have been moved
+  /// already (see DocumentScanner).
   void renamePath(const QString & oldPath, const QString & newPath);
 
   /// Deletes the given file from disk and from the list of documents.
@@ -0,0 +1,138 @@
+/*
+    documentmatcher.cc: matching of many documents against transactions
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <documentmatcher.hh>
+
+#include <wallet.hh>
+#include <document.hh>
+#include <transactioncursor.hh>
+
+DocumentMatcher::DocumentMatcher(const Wallet * wallet, bool skipLinked) :
+  indexed(0)
+{
+  for(AtomicTransaction * t : WalletCursor(wallet)) {
+    if(skipLinked && t->hasNamedLinks("document"))
+      continue;
+    Posting p;
+    p.day = t->getDate().toJulianDay();
+    p.transaction = t;
+    index[abs(t->getAmount())] << p;
+    ++indexed;
+  }
+
+  // The WalletCursor already returns the transactions by date, unless
+  // an account is not sorted.
+  for(QVector<Posting> & postings : index)
+    std::stable_sort(postings.begin(), postings.end(),
+                     [](const Posting & a, const Posting & b) {
+                       return a.day < b.day;
+                     });
+}
+
+void DocumentMatcher::addDocument(Document * doc)
+{
+  if(candidates.contains(doc))
+    return;
+  documents << doc;
+  QList<Suggestion> & lst = candidates[doc];
+
+  Period p = doc->relevantDateRange();
+  if(! p.isValid())
+    return;
+  qint64 first = p.startDate.toJulianDay();
+  qint64 last = p.endDate.toJulianDay();
+
+  QSet<AtomicTransaction *> seen;
+  for(int amount : doc->amounts()) {
+    auto it = index.constFind(abs(amount));
+    if(it == index.constEnd())
+      continue;
+    const QVector<Posting> & postings = *it;
+    auto i = std::lower_bound(postings.begin(), postings.end(), first,
+                              [](const Posting & a, qint64 day) {
+                                return a.day < day;
+                              });
+    for(; i != postings.end() && i->day <= last; ++i) {
+      if(seen.contains(i->transaction))
+        continue;
+      seen.insert(i->transaction);
+      int score = doc->scoreForTransaction(i->transaction);
+      if(score > 0) {
+        Suggestion s = {doc, i->transaction, score};
+        lst << s;
+      }
+    }
+  }
+  std::stable_sort(lst.begin(), lst.end(),
+                   [](const Suggestion & a, const Suggestion & b) {
+                     return a.score > b.score;
+                   });
+}
+
+void DocumentMatcher::resolve()
+{
+  assigned.clear();
+  QList<Suggestion> all;
+  for(Document * doc : documents)
+    all += candidates[doc];
+  std::stable_sort(all.begin(), all.end(),
+                   [](const Suggestion & a, const Suggestion & b) {
+                     return a.score > b.score;
+                   });
+
+  QSet<AtomicTransaction *> taken;
+  for(const Suggestion & s : all) {
+    if(assigned.contains(s.document) || taken.contains(s.transaction))
+      continue;
+    assigned[s.document] = s;
+    taken.insert(s.transaction);
+  }
+}
+
+void DocumentMatcher::match(const QList<Document *> & docs)
+{
+  for(Document * doc : docs)
+    addDocument(doc);
+  resolve();
+}
+
+QList<DocumentMatcher::Suggestion>
+DocumentMatcher::suggestions(Document * doc) const
+{
+  return candidates.value(doc);
+}
+
+AtomicTransaction * DocumentMatcher::matchFor(Document * doc) const
+{
+  auto it = assigned.constFind(doc);
+  if(it == assigned.constEnd())
+    return NULL;
+  return it->transaction;
+}
+
+QList<DocumentMatcher::Suggestion> DocumentMatcher::matches() const
+{
+  QList<Suggestion> rv;
+  for(Document * doc : documents) {
+    auto it = assigned.constFind(doc);
+    if(it != assigned.constEnd())
+      rv << *it;
+  }
+  return rv;
+}
@@ -0,0 +1,114 @@
+/**
+    \file documentmatcher.hh
+    Matching of many documents against the transactions of a wallet
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __DOCUMENTMATCHER_HH
+#define __DOCUMENTMATCHER_HH
+
+class Wallet;
+class Document;
+class AtomicTransaction;
+
+/// Finds the transactions matching a whole batch of documents.
+///
+/// Contrary to Document::findMatchingTransaction(), which looks at
+/// all the transactions in the relevant date range of each document,
+/// the matcher indexes once all the transactions of the Wallet by
+/// their absolute amount, each entry being sorted by date. Only the
+/// transactions with the right amount and date are then given to
+/// Document::scoreForTransaction().
+///
+/// Once all the documents have been added, resolve() assigns the
+/// transactions, making sure that a transaction is never matched by
+/// two documents: the pairs with the best scores are taken first.
+///
+/// The matcher only reads the Wallet, it does not create any link.
+/// It must not be used after the Wallet has been modified.
+class DocumentMatcher {
+public:
+
+  /// A possible match
+  class Suggestion {
+  public:
+    Document * document;
+    AtomicTransaction * transaction;
+    int score;
+  };
+
+protected:
+
+  /// An entry of the index
+  class Posting {
+  public:
+    /// The julian day of the transaction
+    qint64 day;
+    AtomicTransaction * transaction;
+  };
+
+  /// The transactions, by absolute amount, sorted by date
+  QHash<int, QVector<Posting> > index;
+
+  /// The number of transactions indexed
+  int indexed;
+
+  /// The documents, in the order in which they were added
+  QList<Document *> documents;
+
+  /// The possible matches for each document, sorted by decreasing
+  /// score
+  QHash<Document *, QList<Suggestion> > candidates;
+
+  /// The matches chosen by resolve()
+  QHash<Document *, Suggestion> assigned;
+
+public:
+
+  /// Indexes the transactions of the wallet. If @a skipLinked is
+  /// true, the transactions already linked to a document are
+  /// ignored.
+  explicit DocumentMatcher(const Wallet * wallet, bool skipLinked = true);
+
+  /// The number of transactions in the index.
+  int indexedTransactions() const {
+    return indexed;
+  };
+
+  /// Looks for the transactions that could match the given document.
+  /// Does nothing for documents without DocType, or already added.
+  void addDocument(Document * doc);
+
+  /// Assigns the transactions to the documents added so far.
+  void resolve();
+
+  /// Adds all the documents and calls resolve().
+  void match(const QList<Document *> & docs);
+
+  /// All the possible matches for the document, best first.
+  QList<Suggestion> suggestions(Document * doc) const;
+
+  /// The transaction assigned to the document by resolve(), or NULL.
+  AtomicTransaction * matchFor(Document * doc) const;
+
+  /// All the matches chosen by resolve(), in the order in which the
+  /// documents were added.
+  QList<Suggestion> matches() const;
+
+};
+
+#endif
@@ -0,0 +1,358 @@
+/*
+    documentscanner.cc: tracking of the files in the base directory
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <documentscanner.hh>
+
+#include <cabinet.hh>
+
+/// Bumped whenever the format of the manifest changes.
+static const quint32 manifestFormat = 1;
+
+/// The directory containing the given relative path.
+static QString parentDirectory(const QString & path)
+{
+  int idx = path.lastIndexOf('/');
+  return idx < 0 ? QString() : path.left(idx);
+}
+
+/// Whether the relative path is within the given directory (or its
+/// subdirectories).
+static bool isUnder(const QString & directory, const QString & path)
+{
+  if(directory.isEmpty())
+    return true;
+  return path.size() > directory.size() &&
+    path[directory.size()] == '/' && path.startsWith(directory);
+}
+
+DocumentScanner::DocumentScanner(Cabinet * c, QObject * parent) :
+  QObject(parent), cabinet(c), fullScanPending(false),
+  paused(false), scanHeld(false)
+{
+  watcher = new QFileSystemWatcher(this);
+  connect(watcher, SIGNAL(directoryChanged(const QString &)),
+          SLOT(onDirectoryChanged(const QString &)));
+
+  running = new QFutureWatcher<Scan>(this);
+  connect(running, SIGNAL(finished()), SLOT(onScanFinished()));
+
+  delay.setSingleShot(true);
+  delay.setInterval(500);
+  connect(&delay, SIGNAL(timeout()), SLOT(onDelayElapsed()));
+}
+
+DocumentScanner::~DocumentScanner()
+{
+  running->waitForFinished();
+}
+
+QString DocumentScanner::relativePath(const QString & path) const
+{
+  QString rel = cabinet->baseDirectory().relativeFilePath(path);
+  if(rel == ".")
+    rel.clear();
+  return rel;
+}
+
+const FileStamp * DocumentScanner::entry(const QString & file) const
+{
+  QHash<QString, FileStamp>::const_iterator it = manifest.constFind(file);
+  if(it == manifest.constEnd())
+    return NULL;
+  return &it.value();
+}
+
+bool DocumentScanner::reset()
+{
+  if(! watcher->directories().isEmpty())
+    watcher->removePaths(watcher->directories());
+  manifest.clear();
+  knownDirectories.clear();
+  orphans.clear();
+  pendingDirectories.clear();
+  storage.clear();
+
+  QString path = cabinet->fullFilePath();
+  if(path.isEmpty())
+    return false;
+
+  QByteArray hash = QCryptographicHash::hash(path.toUtf8(),
+                                             QCryptographicHash::Sha1);
+  QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + "/manifest");
+  dir.mkpath(".");
+  storage = dir.absoluteFilePath(QString::fromLatin1(hash.toHex()));
+
+  QFile f(storage);
+  if(f.open(QIODevice::ReadOnly)) {
+    QDataStream in(&f);
+    quint32 format;
+    in >> format;
+    if(format == manifestFormat) {
+      in >> manifest;
+      if(in.status() != QDataStream::Ok)
+        manifest.clear();
+    }
+  }
+  return true;
+}
+
+void DocumentScanner::saveManifest()
+{
+  if(storage.isEmpty())
+    return;
+  QSaveFile f(storage);
+  if(! f.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&f);
+  out << manifestFormat << manifest;
+  f.commit();
+}
+
+DocumentScanner::Scan DocumentScanner::prepareScan(const QString & directory,
+                                                   bool recursive) const
+{
+  Scan s;
+  s.base = cabinet->baseDirectory();
+  s.directory = directory;
+  s.recursive = recursive;
+  s.manifest = manifest;        // implicitly shared
+  s.knownDirectories = knownDirectories;
+  return s;
+}
+
+DocumentScanner::Scan DocumentScanner::runScan(Scan scan)
+{
+  QSet<QString> present;
+  QStringList toScan;
+  toScan << scan.directory;
+  while(! toScan.isEmpty()) {
+    QString rel = toScan.takeLast();
+    scan.foundDirectories << rel;
+    present.insert(rel);
+    QString prefix = rel.isEmpty() ? QString() : rel + "/";
+    QDir dir(rel.isEmpty() ? scan.base.absolutePath() :
+             scan.base.absoluteFilePath(rel));
+    for(const QFileInfo & info :
+          dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+      QString path = prefix + info.fileName();
+      if(info.isDir()) {
+        if(info.isSymLink())
+          continue;             // Avoids loops
+        present.insert(path);
+        // The known subdirectories are scanned separately when they
+        // change.
+        if(scan.recursive || ! scan.knownDirectories.contains(path))
+          toScan << path;
+        continue;
+      }
+      FileStamp e(info);
+      QHash<QString, FileStamp>::const_iterator it = scan.manifest.constFind(path);
+      e.hash = e.hashFrom(it == scan.manifest.constEnd() ? NULL : &it.value(),
+                          info.absoluteFilePath());
+      scan.found[path] = e;
+    }
+  }
+
+  for(const QString & d : scan.knownDirectories) {
+    if(d == scan.directory || present.contains(d))
+      continue;
+    if(scan.recursive ? isUnder(scan.directory, d) :
+       parentDirectory(d) == scan.directory)
+      scan.goneDirectories << d;
+  }
+  return scan;
+}
+
+void DocumentScanner::applyScan(const Scan & scan)
+{
+  // The directories whose files were all looked at (or should have
+  // been, for the gone ones)
+  QStringList whole = scan.goneDirectories;
+  if(scan.recursive)
+    whole << scan.directory;
+  else
+    for(const QString & d : scan.foundDirectories)
+      if(d != scan.directory)
+        whole << d;
+
+  QHash<QString, FileStamp> before;
+  for(QHash<QString, FileStamp>::const_iterator it = manifest.constBegin();
+      it != manifest.constEnd(); ++it) {
+    bool scanned = parentDirectory(it.key()) == scan.directory;
+    for(int i = 0; i < whole.size() && ! scanned; i++)
+      scanned = isUnder(whole[i], it.key());
+    if(scanned)
+      before[it.key()] = it.value();
+  }
+
+  // The new files, by hash
+  QMultiHash<QByteArray, QString> appeared;
+  for(QHash<QString, FileStamp>::const_iterator it = scan.found.constBegin();
+      it != scan.found.constEnd(); ++it) {
+    if(! before.contains(it.key()))
+      appeared.insert(it->hash, it.key());
+  }
+
+  QStringList added;
+  QStringList removed;
+  QList<QPair<QString, QString> > renamed;
+  for(QHash<QString, FileStamp>::const_iterator it = before.constBegin();
+      it != before.constEnd(); ++it) {
+    if(scan.found.contains(it.key()))
+      continue;
+    manifest.remove(it.key());
+    if(! it->hash.isEmpty() && appeared.contains(it->hash))
+      renamed << QPair<QString, QString>(it.key(), appeared.take(it->hash));
+    else {
+      if(! it->hash.isEmpty())
+        orphans[it->hash] = it.key();
+      removed << it.key();
+    }
+  }
+  for(QMultiHash<QByteArray, QString>::const_iterator it = appeared.constBegin();
+      it != appeared.constEnd(); ++it) {
+    if(! it.key().isEmpty() && orphans.contains(it.key()))
+      renamed << QPair<QString, QString>(orphans.take(it.key()), it.value());
+    else
+      added << it.value();
+  }
+
+  for(QHash<QString, FileStamp>::const_iterator it = scan.found.constBegin();
+      it != scan.found.constEnd(); ++it)
+    manifest[it.key()] = it.value();
+
+  // Watching the new directories, and forgetting the gone ones
+  QDir base = cabinet->baseDirectory();
+  QStringList newPaths;
+  for(const QString & d : scan.foundDirectories) {
+    if(knownDirectories.contains(d))
+      continue;
+    knownDirectories.insert(d);
+    newPaths << (d.isEmpty() ? base.absolutePath() : base.absoluteFilePath(d));
+  }
+  if(! newPaths.isEmpty())
+    watcher->addPaths(newPaths);
+  for(const QString & g : scan.goneDirectories) {
+    knownDirectories.remove(g);
+    watcher->removePath(base.absoluteFilePath(g));
+  }
+
+  bool dirty = false;
+  for(const QPair<QString, QString> & r : renamed) {
+    if(cabinet->documents.document(r.first) &&
+       ! cabinet->documents.document(r.second)) {
+      cabinet->documents.renamePath(r.first, r.second);
+      dirty = true;
+    }
+  }
+  if(dirty)
+    cabinet->setDirty();
+
+  saveManifest();
+
+  for(const QPair<QString, QString> & r : renamed)
+    emit(fileRenamed(r.first, r.second));
+  if(! removed.isEmpty())
+    emit(filesRemoved(removed));
+  if(! added.isEmpty())
+    emit(filesAdded(added));
+  emit(scanDone());
+}
+
+void DocumentScanner::startNextScan()
+{
+  if(paused || running->isRunning())
+    return;
+  Scan s;
+  if(fullScanPending) {
+    s = prepareScan(QString(), true);
+    fullScanPending = false;
+    pendingDirectories.clear();
+  }
+  else if(! pendingDirectories.isEmpty()) {
+    QSet<QString>::iterator it = pendingDirectories.begin();
+    s = prepareScan(*it, false);
+    pendingDirectories.erase(it);
+  }
+  else
+    return;
+  running->setFuture(QtConcurrent::run(&DocumentScanner::runScan, s));
+}
+
+void DocumentScanner::start()
+{
+  if(! reset())
+    return;
+  fullScanPending = true;
+  startNextScan();
+}
+
+void DocumentScanner::scanNow()
+{
+  running->waitForFinished();
+  if(! reset())
+    return;
+  fullScanPending = false;
+  applyScan(runScan(prepareScan(QString(), true)));
+}
+
+void DocumentScanner::onDirectoryChanged(const QString & path)
+{
+  pendingDirectories.insert(relativePath(path));
+  delay.start();
+}
+
+void DocumentScanner::onDelayElapsed()
+{
+  startNextScan();
+}
+
+void DocumentScanner::pause()
+{
+  paused = true;
+}
+
+void DocumentScanner::resume()
+{
+  if(! paused)
+    return;
+  paused = false;
+  if(scanHeld) {
+    scanHeld = false;
+    onScanFinished();
+  }
+  else
+    startNextScan();
+}
+
+void DocumentScanner::onScanFinished()
+{
+  if(paused) {
+    scanHeld = true;
+    return;
+  }
+  Scan s = running->result();
+  // The Cabinet may have changed in the meantime, in which case a
+  // full scan is pending.
+  if(! fullScanPending &&
+     s.base.absolutePath() == cabinet->baseDirectory().absolutePath())
+    applyScan(s);
+  startNextScan();
+}
@@ -0,0 +1,194 @@
+/**
+    \file documentscanner.hh
+    Tracking of the files in the base directory of a Cabinet
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __DOCUMENTSCANNER_HH
+#define __DOCUMENTSCANNER_HH
+
+#include <filestamp.hh>
+
+class Cabinet;
+
+/// Keeps track of the files in Cabinet::baseDirectory(), so that the
+/// files added, removed or renamed outside of eThunes are noticed.
+///
+/// The scanner keeps a manifest of the FileStamp of all the files. It
+/// is stored in the cache location, one per cabinet. Files are only
+/// read again when their size or modification time changed.
+///
+/// A first scan of the whole tree is done by start(); afterwards,
+/// only the directories for which a QFileSystemWatcher notification
+/// was received are scanned again (and the new subdirectories). The
+/// scans run in a background thread, while their results are applied
+/// in the thread of the scanner.
+///
+/// When a file disappears and a file with the same contents appears
+/// elsewhere, the scanner considers it was renamed, and updates the
+/// corresponding Document using DocumentList::renamePath().
+class DocumentScanner : public QObject {
+
+  Q_OBJECT;
+
+protected:
+
+  /// A scan of a directory. The first members are filled before the
+  /// scan, the other ones by the scan, in the background thread.
+  class Scan {
+  public:
+    /// The base directory
+    QDir base;
+
+    /// The directory scanned, relative to the base directory
+    QString directory;
+
+    /// Whether the subdirectories are scanned too (the new ones
+    /// always are).
+    bool recursive;
+
+    /// A copy of the manifest, to avoid hashing unchanged files
+    QHash<QString, FileStamp> manifest;
+
+    /// A copy of knownDirectories
+    QSet<QString> knownDirectories;
+
+    /// The files found
+    QHash<QString, FileStamp> found;
+
+    /// The directories found, including the scanned one
+    QStringList foundDirectories;
+
+    /// The known subdirectories that no longer exist
+    QStringList goneDirectories;
+  };
+
+  Cabinet * cabinet;
+
+  /// Relative file name -> entry
+  QHash<QString, FileStamp> manifest;
+
+  /// All the directories of the tree, relative to the base directory
+  /// (the base directory itself being the empty string).
+  QSet<QString> knownDirectories;
+
+  /// The files that disappeared, by hash, in case they show up again
+  /// in a directory scanned later on.
+  QHash<QByteArray, QString> orphans;
+
+  /// Where the manifest is saved
+  QString storage;
+
+  QFileSystemWatcher * watcher;
+
+  /// The directories to scan again
+  QSet<QString> pendingDirectories;
+
+  /// Groups the notifications that arrive in quick succession
+  QTimer delay;
+
+  /// The scan running in the background, if any
+  QFutureWatcher<Scan> * running;
+
+  /// Whether the next scan is a scan of the whole tree
+  bool fullScanPending;
+
+  /// Whether the scanner is paused, see pause()
+  bool paused;
+
+  /// Whether a scan finished while the scanner was paused
+  bool scanHeld;
+
+  /// Does the scan. Only accesses the file system, and can run in any
+  /// thread.
+  static Scan runScan(Scan scan);
+
+  /// Prepares a Scan of the given directory.
+  Scan prepareScan(const QString & directory, bool recursive) const;
+
+  /// Starts the next scan in the background, if there is anything to
+  /// scan and nothing running.
+  void startNextScan();
+
+  /// Merges the results of the scan into the manifest, and notifies
+  /// the changes.
+  void applyScan(const Scan & scan);
+
+  /// Forgets everything, and reads the manifest of the current
+  /// Cabinet. Returns false if the Cabinet has no file yet.
+  bool reset();
+
+  void saveManifest();
+
+  /// Returns the path relative to the base directory
+  QString relativePath(const QString & path) const;
+
+public:
+
+  explicit DocumentScanner(Cabinet * cabinet, QObject * parent = NULL);
+  virtual ~DocumentScanner();
+
+  /// The entry for the given file, relative to the base directory, or
+  /// NULL if it is not known.
+  const FileStamp * entry(const QString & file) const;
+
+  /// Scans the whole tree synchronously. Mostly useful for the
+  /// command-line.
+  void scanNow();
+
+  /// Stops applying scans (and so modifying the DocumentList) until
+  /// resume() is called. The notifications are still recorded, and
+  /// a scan running in the background finishes, but its results are
+  /// only applied by resume().
+  void pause();
+
+  /// Applies the scan that finished during the pause, if any, and
+  /// starts the scans requested meanwhile.
+  void resume();
+
+signals:
+
+  /// Emitted when new files were found
+  void filesAdded(const QStringList & files);
+
+  /// Emitted when files have disappeared
+  void filesRemoved(const QStringList & files);
+
+  /// Emitted when a file was renamed. The corresponding Document, if
+  /// any, is renamed already.
+  void fileRenamed(const QString & oldName, const QString & newName);
+
+  /// Emitted when a scan was applied
+  void scanDone();
+
+public slots:
+
+  /// Starts watching the base directory of the Cabinet, and scans it
+  /// completely in the background. Called again whenever the Cabinet
+  /// is loaded.
+  void start();
+
+protected slots:
+
+  void onDirectoryChanged(const QString & path);
+
+  void onScanFinished();
+
+  void onDelayElapsed();
+};
+
+#endif
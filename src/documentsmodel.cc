@@ -165,6 +165,7 @@ bool DocumentsModel::setData(const QModelIndex &index, const QVariant &value, in
             v = s;
           }
           doc->attributes["date"] = v;
+          cabinet->documents.textIndex.documentChanged(doc);
           return true;
         }
       }
@@ -172,6 +173,7 @@ bool DocumentsModel::setData(const QModelIndex &index, const QVariant &value, in
       if(doc) {
         if(role == Qt::DisplayRole || role == Qt::EditRole) {
           doc->attributes["amount"] = value.toInt();
+          cabinet->documents.textIndex.documentChanged(doc);
           return true;
         }
       }
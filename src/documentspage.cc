@@ -26,6 +26,8 @@
 #include <atomictransaction.hh>
 #include <documentwidget.hh>
 #include <accountmodel.hh>
+#include <documentingestion.hh>
+#include <documentscanner.hh>
 
 
 static QAction * createAction(const QString & name, 
@@ -60,6 +62,12 @@ void DocumentsPage::addCMAction(const QString & name,
 DocumentsPage::DocumentsPage(Cabinet * c) : cabinet(c)
 {
   QVBoxLayout * layout = new QVBoxLayout(this);
+  searchField = new QLineEdit;
+  searchField->setPlaceholderText(tr("Search documents: words, prefix*, \"phrase\""));
+  searchField->setClearButtonEnabled(true);
+  connect(searchField, SIGNAL(returnPressed()), SLOT(searchDocuments()));
+  layout->addWidget(searchField);
+
   splitter = new QSplitter(Qt::Vertical, this);
   layout->addWidget(splitter);
 
@@ -123,6 +131,13 @@ DocumentsPage::DocumentsPage(Cabinet * c) : cabinet(c)
               QKeySequence(QString("Ctrl+D")));
   addCMAction("Edit amount", this, SLOT(editCurrentAmount()),
               QKeySequence(QString("Ctrl+A")));
+  addCMAction("Process new documents", this, SLOT(processNewDocuments()));
+
+  // Keeping track of the files renamed outside
+  scanner = new DocumentScanner(cabinet, this);
+  connect(cabinet, SIGNAL(fileLoaded()), scanner, SLOT(start()));
+  connect(scanner, SIGNAL(scanDone()), treeView->viewport(), SLOT(update()));
+  scanner->start();
 }
 
 
@@ -170,19 +185,7 @@ AtomicTransaction * DocumentsPage::findMatchingTransaction(const Document * doc)
     << " -> " << p.endDate.toString()
     << "\n ---- " << doc->docType() <<  endl;
   
-  if(! p.isValid())
-    return NULL;
-  TransactionPtrList trs = cabinet->wallet.transactionsForPeriod(p);
-  AtomicTransaction * rv = NULL;
-  int score = 0;
-  for(AtomicTransaction * t : trs) {
-    int s = doc->scoreForTransaction(t);
-    if(s > score) {
-      score = s;
-      rv = t;
-    }
-  }
-
+  AtomicTransaction * rv = doc->findMatchingTransaction(&cabinet->wallet);
   o << " -> found: " << rv << endl;
   return rv;
 }
@@ -222,12 +225,15 @@ QList<Document*> DocumentsPage::selectedDocuments()
   return sels;
 }
 
-static void fillWithDocTypes(QMenu * menu,   QList<Document *> docs) {
+static void fillWithDocTypes(QMenu * menu,   QList<Document *> docs,
+                             DocumentList * list) {
   QMenu * subMenu = new QMenu(QObject::tr("Document type"));
   QAction * a = new QAction(QObject::tr("Autodetect"));
-  QObject::connect(a, &QAction::triggered, [docs](bool) {
-      for(Document * doc : docs)
+  QObject::connect(a, &QAction::triggered, [docs, list](bool) {
+      for(Document * doc : docs) {
         doc->autoDetectDocType();
+        list->textIndex.documentChanged(doc);
+      }
     }
     );
   subMenu->addAction(a);
@@ -269,7 +275,7 @@ void DocumentsPage::treeViewContextMenu(const QPoint & pos)
 
   menu.addSeparator();
   // Now fill with types !
-  fillWithDocTypes(&menu, docs);
+  fillWithDocTypes(&menu, docs, &cabinet->documents);
 
   menu.addSeparator();
 
@@ -307,6 +313,15 @@ void DocumentsPage::onCurrentDocumentChanged(const QModelIndex &current,
                                              const QModelIndex &)
 {
   documentWidget->showDocument(model->filePath(current));
+
+  // The neighbours are likely to be shown next
+  QStringList next;
+  for(int delta : {1, -1, 2}) {
+    QModelIndex idx = current.sibling(current.row() + delta, 0);
+    if(idx.isValid() && ! model->isDir(idx))
+      next << model->filePath(idx);
+  }
+  documentWidget->prefetchDocuments(next);
 }
 
 void DocumentsPage::onDocumentActivated(const QModelIndex & index)
@@ -320,6 +335,72 @@ void DocumentsPage::onDocumentActivated(const QModelIndex & index)
   QDesktopServices::openUrl(QUrl::fromLocalFile(s));
 }
 
+void DocumentsPage::processNewDocuments()
+{
+  // The current directory, or the whole cabinet
+  QString dir;
+  QModelIndex idx = treeView->currentIndex();
+  if(idx.isValid() && model->isDir(idx))
+    dir = model->absoluteFilePath(idx);
+  else
+    dir = cabinet->baseDirectory().absolutePath();
+
+  DocumentIngestion ingestion(cabinet);
+  QStringList files = ingestion.newFiles(dir);
+  if(files.isEmpty())
+    return;
+
+  // The processing keeps the interface alive through the progress
+  // dialog, which is modal so that nothing can modify the wallet or
+  // the documents while the transactions are being matched. The
+  // scanner is paused for the same reason.
+  QProgressDialog progress(tr("Processing new documents..."), tr("Cancel"),
+                           0, files.size(), this);
+  progress.setWindowModality(Qt::ApplicationModal);
+  progress.setMinimumDuration(500);
+  ingestion.progress = [&progress](int done, int total) -> bool {
+    progress.setMaximum(total);
+    progress.setValue(done);
+    QCoreApplication::processEvents();
+    return ! progress.wasCanceled();
+  };
+  scanner->pause();
+  ingestion.process(files);
+  progress.reset();
+  int nb = ingestion.commit();
+  scanner->resume();
+  QMessageBox::information(this, tr("New documents"),
+                           tr("Added %1 documents\n\n%2").
+                           arg(nb).arg(ingestion.report()));
+}
+
+void DocumentsPage::searchDocuments()
+{
+  QString query = searchField->text().trimmed();
+  treeView->clearSelection();
+  if(query.isEmpty())
+    return;
+  QList<Document *> docs = cabinet->documents.textIndex.search(query);
+  QItemSelection selection;
+  QModelIndex first;
+  for(const Document * doc : docs) {
+    QModelIndex idx = model->index(doc->filePath());
+    if(! idx.isValid())
+      continue;
+    if(! first.isValid())
+      first = idx;
+    selection.select(idx, idx);
+  }
+  treeView->selectionModel()->
+    select(selection, QItemSelectionModel::ClearAndSelect |
+           QItemSelectionModel::Rows);
+  if(first.isValid())
+    treeView->scrollTo(first);   // Expands the parents too
+  else
+    QMessageBox::information(this, tr("Search"),
+                             tr("No document matches %1").arg(query));
+}
+
 void DocumentsPage::editCurrentDate()
 {
   editCurrentColumn(model->nativeColumns + DocumentsModel::DateColumn);
@@ -28,6 +28,7 @@ class DocumentsModel;
 class Document;
 class DocumentWidget;
 class AtomicTransaction;
+class DocumentScanner;
 
 /// This NavigationPage displays the informations about documentss
 class DocumentsPage : public NavigationPage {
@@ -52,6 +53,12 @@ protected:
   /// The bottom document view
   DocumentWidget * documentWidget;
 
+  /// Follows the changes in the files of the cabinet
+  DocumentScanner * scanner;
+
+  /// The search field for the documents
+  QLineEdit * searchField;
+
   QList<Document*> selectedDocuments();
 
   /// Additional actions to add to the context menu
@@ -100,6 +107,14 @@ protected slots:
 
   void onItemExpanded(const QModelIndex &item);
 
+  /// Processes all the PDF files of the current directory that are
+  /// not documents yet, using DocumentIngestion.
+  void processNewDocuments();
+
+  /// Selects the documents matching the query of the search field,
+  /// see DocumentTextIndex.
+  void searchDocuments();
+
   /// Edits the current date
   void editCurrentDate();
 
@@ -23,14 +23,20 @@
 #include <doctype.hh>
 #include <cabinet.hh>
 #include <attributehashwidget.hh>
-
-#include <poppler/qt5/poppler-qt5.h>
-#include <memory>
+#include <pdftools.hh>
 
 
 DocumentWidget::DocumentWidget(Cabinet * c, QWidget * parent) :
-  QWidget(parent), document(NULL), cabinet(c)
+  QWidget(parent), document(NULL), cabinet(c), currentPage(0)
 {
+  QScreen * scr = QGuiApplication::primaryScreen();
+  resolution = qRound(scr->physicalDotsPerInch() * 0.8);
+
+  renderer = PageRenderer::globalRenderer();
+  connect(renderer,
+          SIGNAL(pageRendered(const QString &, int, int, const QImage &)),
+          SLOT(onPageRendered(const QString &, int, int, const QImage &)));
+
   setupFrame();
   showDocument(QString());
 }
@@ -65,6 +71,7 @@ void DocumentWidget::setupFrame()
       if(! document)
         document = cabinet->documents.modifiableDocument(fileName);
       document->autoDetectDocType();
+      cabinet->documents.textIndex.documentChanged(document);
       showDocument(fileName);
     }
     );
@@ -76,6 +83,8 @@ void DocumentWidget::setupFrame()
 
   attributesEditor = new AttributeHashWidget;
   layout->addWidget(attributesEditor);
+  connect(attributesEditor, SIGNAL(hashChanged()),
+          SLOT(onAttributesChanged()));
 
   layout->addStretch(1);
 
@@ -99,31 +108,44 @@ void DocumentWidget::setupFrame()
   
 }
 
+QString DocumentWidget::absolutePath(const QString & file) const
+{
+  return Cabinet::globalCabinet()->baseDirectory().absoluteFilePath(file);
+}
+
 void DocumentWidget::showPage(int page)
 {
-  QString af = Cabinet::globalCabinet()->
-    baseDirectory().absoluteFilePath(fileName);
-  std::unique_ptr<Poppler::Document> doc(Poppler::Document::load(af));
-  QTextStream o(stdout);
-  if(! doc || doc->isLocked()) {
-    o << "Failed to load document: " << af << endl;
-    return;
-  }
-  std::unique_ptr<Poppler::Page> pdfPage(doc->page(page));
   // Document starts at page 0
-  if(! pdfPage)
+  currentPage = page;
+  pageDisplay->clear();
+  QString af = absolutePath(fileName);
+  if(fileName.isEmpty() || ! QFileInfo(af).isFile())
     return;
 
-  QScreen * scr = QGuiApplication::primaryScreen();
-
-  double res = scr->physicalDotsPerInch() * 0.8;
-  
-  QImage image = pdfPage->renderToImage(res, res);
+  // The requests for the previous document are not needed anymore.
+  renderer->cancelPending();
+  renderer->request(af, page, resolution);
+}
 
+void DocumentWidget::onPageRendered(const QString & file, int page,
+                                    int res, const QImage & image)
+{
+  if(page != currentPage || res != resolution || fileName.isEmpty() ||
+     file != absolutePath(fileName))
+    return;
   pageDisplay->setPixmap(QPixmap::fromImage(image));
   pageDisplay->resize(image.size());
 }
 
+void DocumentWidget::prefetchDocuments(const QStringList & docs)
+{
+  for(const QString & d : docs) {
+    QString af = absolutePath(d);
+    if(QFileInfo(af).isFile())
+      renderer->request(af, 0, resolution);
+  }
+}
+
 void DocumentWidget::showDocument(const QString & str)
 {
   fileName = str;
@@ -151,6 +173,12 @@ void DocumentWidget::showDocument(const QString & str)
   showPage(0);
 }
 
+void DocumentWidget::onAttributesChanged()
+{
+  if(document)
+    cabinet->documents.textIndex.documentChanged(document);
+}
+
 void DocumentWidget::onTypeChanged(const QString & newType)
 {
   if(! document)
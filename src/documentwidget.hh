@@ -26,6 +26,7 @@
 class Cabinet;
 class Document;
 class AttributeHashWidget;
+class PageRenderer;
 
 /// A widget displaying the contents of a document, possibly offering
 /// edition of the document type
@@ -63,9 +64,21 @@ class DocumentWidget : public QWidget {
   /// Facilities for editing the attributes
   AttributeHashWidget * attributesEditor;
 
+  /// Renders the pages in the background
+  PageRenderer * renderer;
+
+  /// The page being displayed
+  int currentPage;
+
+  /// The resolution of the page display, in dots per inch
+  int resolution;
+
   /// Sets up the frame
   void setupFrame();
 
+  /// The absolute path of the given file
+  QString absolutePath(const QString & file) const;
+
 public:
 
   DocumentWidget(Cabinet * c, QWidget * parent = NULL);
@@ -76,12 +89,23 @@ public slots:
   /// Shows the given document.
   void showDocument(const QString & doc);
 
+  /// Renders in advance the first page of the given documents, which
+  /// are likely to be shown next.
+  void prefetchDocuments(const QStringList & docs);
+
 protected slots:
   /// Called on changing type
   void onTypeChanged(const QString & newType);
 
+  /// Called when the attributes were edited
+  void onAttributesChanged();
+
   /// Shows the page
   void showPage(int i);
+
+  /// Displays the page if it is the one expected.
+  void onPageRendered(const QString & file, int page, int resolution,
+                      const QImage & image);
 };
 
 
@@ -64,12 +64,33 @@ public:
   EvolvingItem(const T & t) : firstValue(t) { 
   };
 
-  /// Returns the value at the given time
+  /// Returns the value at the given time. As itemChanges is sorted,
+  /// this is a binary search.
   T operator[](const QDate & when) const {
-    T ret = firstValue;
-    for(int i = 0; i < itemChanges.size(); i++)
-      if(when >= itemChanges[i].date)
-        ret = itemChanges[i].value;
+    typename QList<StoragePair>::const_iterator i =
+      std::upper_bound(itemChanges.constBegin(), itemChanges.constEnd(),
+                       StoragePair(when, firstValue));
+    if(i == itemChanges.constBegin())
+      return firstValue;
+    --i;
+    return i->value;
+  };
+
+  /// Returns the values at all the given dates, which must be sorted
+  /// in increasing order. This is done in a single pass over both
+  /// lists.
+  QVector<T> valuesAt(const QList<QDate> & dates) const {
+    QVector<T> ret;
+    ret.reserve(dates.size());
+    int idx = 0;
+    T cur = firstValue;
+    for(const QDate & when : dates) {
+      while(idx < itemChanges.size() && itemChanges[idx].date <= when) {
+        cur = itemChanges[idx].value;
+        ++idx;
+      }
+      ret << cur;
+    }
     return ret;
   };
 
@@ -101,8 +122,14 @@ public:
     return ac;
   };
 
+  virtual void finishedSerializationRead() override {
+    sort();
+  };
+
+  /// Sorts the changes by date. The sort is stable, so that the last
+  /// of several changes on the same date wins, like before sorting.
   void sort() {
-    qSort(itemChanges);
+    std::stable_sort(itemChanges.begin(), itemChanges.end());
   };
 
   /// Add a change date
@@ -0,0 +1,152 @@
+/*
+    fetchscheduler.cc: scheduling of concurrent HTTP requests
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <fetchscheduler.hh>
+
+#include <logstream.hh>
+
+FetchScheduler::FetchScheduler(QNetworkAccessManager * m, QObject * parent) :
+  QObject(parent), manager(m), maxConnectionsPerHost(4),
+  followRedirections(true), maxRedirections(7)
+{
+  connect(manager, SIGNAL(finished(QNetworkReply*)),
+          SLOT(replyFinished(QNetworkReply*)));
+}
+
+void FetchScheduler::fetch(const Request & request)
+{
+  QueuedRequest r;
+  r.request = request;
+  r.maxHops = maxRedirections;
+  r.batch = NULL;
+  r.slot = 0;
+  enqueue(r);
+}
+
+void FetchScheduler::fetchAll(const QList<Request> & requests)
+{
+  if(requests.isEmpty()) {
+    emit(batchFinished(QVector<QNetworkReply *>()));
+    return;
+  }
+  Batch * batch = new Batch;
+  batch->replies.resize(requests.size());
+  batch->remaining = requests.size();
+  for(int i = 0; i < requests.size(); i++) {
+    QueuedRequest r;
+    r.request = requests[i];
+    r.maxHops = maxRedirections;
+    r.batch = batch;
+    r.slot = i;
+    enqueue(r);
+  }
+}
+
+bool FetchScheduler::isIdle() const
+{
+  return ongoingRequests.isEmpty() && queuedRequests.isEmpty();
+}
+
+void FetchScheduler::enqueue(const QueuedRequest & request)
+{
+  QueuedRequest r = request;
+  // Several requests can be sent over the same connection without
+  // waiting for the replies.
+  r.request.request.
+    setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+  QString host = r.request.request.url().host();
+  queuedRequests[host] << r;
+  startQueued(host);
+}
+
+void FetchScheduler::startQueued(const QString & host)
+{
+  if(! queuedRequests.contains(host))
+    return;
+  QList<QueuedRequest> & queue = queuedRequests[host];
+  int & active = activeRequests[host];
+  while(active < maxConnectionsPerHost && ! queue.isEmpty()) {
+    QueuedRequest r = queue.takeFirst();
+    QNetworkReply * reply = r.request.post ?
+      manager->post(r.request.request, r.request.data) :
+      manager->get(r.request.request);
+    ++active;
+    ongoingRequests[reply] = r;
+    emit(requestSent(reply));
+  }
+  if(queue.isEmpty())
+    queuedRequests.remove(host);
+}
+
+void FetchScheduler::deliver(QNetworkReply * reply,
+                             const QueuedRequest & request)
+{
+  Batch * batch = request.batch;
+  if(! batch) {
+    emit(finished(reply));
+    return;
+  }
+  batch->replies[request.slot] = reply;
+  if(--batch->remaining > 0)
+    return;
+  QVector<QNetworkReply *> replies = batch->replies;
+  delete batch;
+  emit(batchFinished(replies));
+}
+
+void FetchScheduler::replyFinished(QNetworkReply * r)
+{
+  LogStream err(Log::Error);
+  LogStream info(Log::Info);
+  if(! ongoingRequests.contains(r)) {
+    err << "Unkown reply " << r << endl
+	<< "\tfor URL" << r->url().toString() << endl;
+    return;
+  }
+
+  // In any case, the request is done, and frees a connection slot
+  // for the next requests to the same host.
+  QueuedRequest request = ongoingRequests.take(r);
+  QString host = r->request().url().host();
+  if(--activeRequests[host] <= 0)
+    activeRequests.remove(host);
+  startQueued(host);
+
+  if(followRedirections && r->hasRawHeader("location")) {
+    // That looks very much like a redirection
+    QUrl target =
+      r->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+    target = r->url().resolved(target);
+    info << " -> redirects to " << target.toString() << endl;
+    if(--request.maxHops > 0) {
+      // The redirection keeps the place of the request in its batch
+      request.request = Request(QNetworkRequest(target));
+      enqueue(request);
+    }
+    else {
+      err << "Maximum number of redirections hit, stopping" << endl;
+      deliver(r, request);
+    }
+  }
+  else
+    deliver(r, request);
+
+  if(isIdle())
+    emit(idle());
+}
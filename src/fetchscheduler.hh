@@ -0,0 +1,163 @@
+/**
+    \file fetchscheduler.hh
+    Scheduling of concurrent HTTP requests, with per-host limits
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __FETCHSCHEDULER_HH
+#define __FETCHSCHEDULER_HH
+
+/// Sends requests through a QNetworkAccessManager, following the
+/// redirections, with at most maxConnectionsPerHost requests underway
+/// for each host. The others wait in a per-host queue.
+///
+/// The requests allow HTTP pipelining, and the QNetworkAccessManager
+/// keeps the connections alive, so that the following requests to the
+/// same host reuse them.
+///
+/// Requests sent alone with fetch() are handed back through
+/// finished(); the requests of a batch (see fetchAll()) are handed
+/// back all together through batchFinished(), in the order of the
+/// requests.
+///
+/// This class knows nothing about Ruby. The Fetcher does not use it
+/// yet, since fetcher.cc is not part of the build.
+class FetchScheduler : public QObject {
+  Q_OBJECT;
+
+public:
+
+  /// A request, GET or POST.
+  class Request {
+  public:
+    QNetworkRequest request;
+
+    /// Whether it is a POST request
+    bool post;
+
+    /// The data of the POST request
+    QByteArray data;
+
+    /// A GET request
+    Request(const QNetworkRequest & r = QNetworkRequest()) :
+      request(r), post(false) {;};
+
+    /// A POST request
+    Request(const QNetworkRequest & r, const QByteArray & d) :
+      request(r), post(true), data(d) {;};
+  };
+
+protected:
+
+  /// A group of requests issued together, whose replies are handed
+  /// back together.
+  class Batch {
+  public:
+    /// The final replies, as they arrive
+    QVector<QNetworkReply *> replies;
+
+    /// The number of requests not finished yet
+    int remaining;
+  };
+
+  /// A request waiting for a connection to its host.
+  class QueuedRequest {
+  public:
+    Request request;
+
+    /// maximum number of redirections left
+    int maxHops;
+
+    /// The batch the request belongs to, or NULL for a single request
+    Batch * batch;
+
+    /// The position in the batch
+    int slot;
+  };
+
+  /// The network manager
+  QNetworkAccessManager * manager;
+
+  /// Requests currently underway
+  QHash<QNetworkReply *, QueuedRequest> ongoingRequests;
+
+  /// The requests waiting for a connection, by host
+  QHash<QString, QList<QueuedRequest> > queuedRequests;
+
+  /// The number of requests underway, by host
+  QHash<QString, int> activeRequests;
+
+  /// Queues the request, and starts it if there are less than
+  /// maxConnectionsPerHost requests underway for its host.
+  void enqueue(const QueuedRequest & request);
+
+  /// Starts the requests queued for the host, as far as the
+  /// connection limit allows.
+  void startQueued(const QString & host);
+
+  /// Hands the reply over, directly or through its batch.
+  void deliver(QNetworkReply * reply, const QueuedRequest & request);
+
+public:
+
+  /// The manager is not owned by the scheduler; all the replies it
+  /// gives must go through the scheduler.
+  explicit FetchScheduler(QNetworkAccessManager * manager,
+                          QObject * parent = NULL);
+
+  /// The maximum number of simultaneous requests to the same host.
+  int maxConnectionsPerHost;
+
+  /// Whether redirections are followed (by sending GET requests). On
+  /// by default.
+  bool followRedirections;
+
+  /// The maximum number of redirections for a request
+  int maxRedirections;
+
+  /// Sends the request; its final reply is given by finished().
+  void fetch(const Request & request);
+
+  /// Sends the requests concurrently; the final replies are given all
+  /// at once by batchFinished(). With no requests, batchFinished() is
+  /// emitted right away.
+  void fetchAll(const QList<Request> & requests);
+
+  /// Whether no request is underway or queued.
+  bool isIdle() const;
+
+signals:
+
+  /// Emitted whenever a request is sent, including the ones following
+  /// redirections.
+  void requestSent(QNetworkReply * reply);
+
+  /// The final reply of a request sent with fetch().
+  void finished(QNetworkReply * reply);
+
+  /// The final replies of the requests of a fetchAll(), in order.
+  void batchFinished(const QVector<QNetworkReply *> & replies);
+
+  /// Emitted when the last request underway is finished.
+  void idle();
+
+protected slots:
+
+  void replyFinished(QNetworkReply * reply);
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+    filestamp.cc: detection of the changes in files
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <filestamp.hh>
+
+FileStamp::FileStamp() : size(-1), modified(-1)
+{
+}
+
+FileStamp::FileStamp(const QFileInfo & info) :
+  size(info.size()),
+  modified(info.lastModified().toMSecsSinceEpoch())
+{
+}
+
+QByteArray FileStamp::hashFrom(const FileStamp * known,
+                               const QString & file) const
+{
+  if(known && sameFile(*known) && ! known->hash.isEmpty())
+    return known->hash;
+  return hashFile(file);
+}
+
+QByteArray FileStamp::hashFile(const QString & file)
+{
+  QFile f(file);
+  if(! f.open(QIODevice::ReadOnly))
+    return QByteArray();
+  QCryptographicHash h(QCryptographicHash::Sha1);
+  if(! h.addData(&f))
+    return QByteArray();
+  return h.result();
+}
+
+QDataStream & operator<<(QDataStream & out, const FileStamp & s)
+{
+  return out << s.size << s.modified << s.hash;
+}
+
+QDataStream & operator>>(QDataStream & in, FileStamp & s)
+{
+  return in >> s.size >> s.modified >> s.hash;
+}
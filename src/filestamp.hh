@@ -0,0 +1,64 @@
+/**
+    \file filestamp.hh
+    Detection of the changes in files without reading them
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __FILESTAMP_HH
+#define __FILESTAMP_HH
+
+/// The size and modification time of a file, along with the SHA-1 of
+/// its contents when it had them. As long as the size and the
+/// modification time do not change, the hash is reused rather than
+/// computed again.
+///
+/// Used by PDFCache and DocumentScanner, which store them on disk
+/// (the QDataStream format is size, modification time and hash).
+class FileStamp {
+public:
+  qint64 size;
+
+  /// In milliseconds since the epoch
+  qint64 modified;
+
+  /// Empty if it wasn't computed
+  QByteArray hash;
+
+  FileStamp();
+
+  /// The size and modification time of the file, without the hash.
+  explicit FileStamp(const QFileInfo & info);
+
+  /// Whether the size and modification time are the same as those of
+  /// @a other, in which case the file is deemed unchanged.
+  bool sameFile(const FileStamp & other) const {
+    return size == other.size && modified == other.modified;
+  };
+
+  /// Returns the hash of @a known if it is the stamp of the same
+  /// file, or computes the hash of the contents of @a file otherwise.
+  QByteArray hashFrom(const FileStamp * known, const QString & file) const;
+
+  /// Computes the SHA-1 of the contents of the file, or returns an
+  /// empty QByteArray if it cannot be read.
+  static QByteArray hashFile(const QString & file);
+};
+
+QDataStream & operator<<(QDataStream & out, const FileStamp & s);
+QDataStream & operator>>(QDataStream & in, FileStamp & s);
+
+#endif
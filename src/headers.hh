@@ -97,11 +97,19 @@
 // Non-GUI objects
 #include <QDate>
 #include <QString>
+#include <QRegularExpression>
 #include <QFile>
 #include <QTextStream>
 #include <QProcess>
 #include <QPointer>
 #include <QTemporaryFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QEventLoop>
 
 // Network
 #include <QNetworkAccessManager>
@@ -110,15 +118,29 @@
 #include <QNetworkCookie>
 #include <QNetworkCookieJar>
 #include <QNetworkProxy>
+#include <QTcpServer>
+#include <QTcpSocket>
 
 // Templates
 #include <QHash>
 #include <QCache>
+#include <QSharedPointer>
 #include <QMultiHash>
 #include <QList>
+#include <QQueue>
+#include <QVarLengthArray>
 
 #include <QMutex>
 #include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThreadStorage>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+// Multithreading
+#include <QThread>
+#include <QtConcurrent>
+#include <QFutureWatcher>
 
 
 // QML-related classes
@@ -113,14 +113,15 @@ int Link::finalizePendingLinks(Cabinet * cabinet)
   return 0;
 }
 
-void LinkList::addLink(Linkable * target, const QString & name)
+bool LinkList::addLink(Linkable * target, const QString & name)
 {
   for(int i = 0; i < size(); i++) {
     const Link & link = value(i);
     if(link.linkTarget() == target && link.linkName == name)
-      return;                   // already done
+      return false;             // already done
   }
   append(Link(target, name));
+  return true;
 }
 
 QStringList LinkList::htmlLinkList() const
@@ -73,7 +73,9 @@ class LinkList : public WatchedList<Link> {
 public:
   /// Adds a link to the given target, making sure there are no
   /// duplicates.
-  void addLink(Linkable * target, const QString & name = "");
+  ///
+  /// Returns false if the link already existed.
+  bool addLink(Linkable * target, const QString & name = "");
 
   /// Returns a list of html links suitable for use with LinksHandler.
   /// You just need to join the result to get a decent string.
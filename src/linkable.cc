@@ -30,8 +30,10 @@ void Linkable::addLink(Linkable * target, const QString & name)
 {
   if(!target)
     return;
-  links.addLink(target, name);
-  target->links.addLink(this, name);
+  if(links.addLink(target, name))
+    linkAdded(target, name);
+  if(target->links.addLink(this, name))
+    target->linkAdded(this, name);
 }
 
 int Linkable::linkIndex(Linkable * target, const QString & name) const
@@ -54,6 +56,7 @@ int Linkable::removeLink(Linkable * target, const QString & name)
     const Link & lnk = links[fnd];
     QString n = lnk.linkName;
     links.takeAt(fnd);
+    linkRemoved(target, n);
     nb++;
     target->removeLink(this, n);
   }
@@ -93,6 +93,15 @@ protected:
   /// synchronized using the appropriate mutex.
   static int getFreeID();
 
+  /// Called by addLink() when a link to @a target was added to this
+  /// object, either because addLink() was called on this object or
+  /// on the target.
+  virtual void linkAdded(Linkable * /*target*/, const QString & /*name*/) {;};
+
+  /// Called by removeLink() when a link to @a target was removed from
+  /// this object.
+  virtual void linkRemoved(Linkable * /*target*/, const QString & /*name*/) {;};
+
 public:
 
   /// This functions makes sure that the object has a registered ID.
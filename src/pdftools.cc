@@ -19,6 +19,10 @@
 #include <headers.hh>
 #include <pdftools.hh>
 
+#include <settings-templates.hh>
+
+#include <memory>
+
 
 static AttributeHash popplerReadAllPages(Poppler::Document * doc)
 {
@@ -49,7 +53,7 @@ static AttributeHash popplerReadAllPages(Poppler::Document * doc)
 }
 
 
-AttributeHash PDFTools::readPDF(QString file)
+AttributeHash PDFTools::readPDFUncached(const QString & file)
 {
   AttributeHash retval;
   // Now using Poppler
@@ -63,3 +67,424 @@ AttributeHash PDFTools::readPDF(QString file)
 
   return retval;
 }
+
+AttributeHash PDFTools::readPDF(QString file)
+{
+  return PDFCache::globalCache()->read(file);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/// The maximum size of the PDF cache, in megabytes
+static SettingsValue<int> pdfCacheSize("pdf/cache-size", 64);
+
+/// Bumped whenever the format of the entries or of the index
+/// changes, which discards the previous ones.
+static const quint32 cacheFormat = 1;
+
+PDFCache::PDFCache(const QString & dir) :
+  directory(dir), stampsLoaded(false), stampsDirty(false),
+  totalSize(-1),
+  maxSize(((qint64) pdfCacheSize) << 20), hits(0), misses(0)
+{
+  directory.mkpath(".");
+}
+
+PDFCache::~PDFCache()
+{
+  flush();
+}
+
+PDFCache * PDFCache::globalCache()
+{
+  static PDFCache cache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pdf");
+  return &cache;
+}
+
+QString PDFCache::entryPath(const QByteArray & hash) const
+{
+  return directory.absoluteFilePath(QString::fromLatin1(hash.toHex()));
+}
+
+void PDFCache::loadStamps()
+{
+  if(stampsLoaded)
+    return;
+  stampsLoaded = true;
+  QFile f(directory.absoluteFilePath("index"));
+  if(! f.open(QIODevice::ReadOnly))
+    return;
+  QDataStream in(&f);
+  quint32 format;
+  in >> format;
+  if(format != cacheFormat)
+    return;
+  in >> stamps;
+  if(in.status() != QDataStream::Ok)
+    stamps.clear();
+}
+
+void PDFCache::saveStamps()
+{
+  QSaveFile f(directory.absoluteFilePath("index"));
+  if(! f.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&f);
+  out << cacheFormat << stamps;
+  if(f.commit())
+    stampsDirty = false;
+}
+
+void PDFCache::flush()
+{
+  QMutexLocker lock(&mutex);
+  if(stampsDirty)
+    saveStamps();
+}
+
+void PDFCache::addStamp(const QString & path, const FileStamp & stamp,
+                        qint64 written)
+{
+  stamps[path] = stamp;
+  stampsDirty = true;
+  if(written > 0) {
+    if(totalSize >= 0)
+      totalSize += written;
+    evict();
+  }
+}
+
+/// Sets the modification time of the file to now, which evict() takes
+/// as the time of the last use. QFile::setFileTime() needs the file
+/// to be open for writing.
+static void touchFile(const QString & path)
+{
+  QFile f(path);
+  if(f.open(QIODevice::ReadWrite))
+    f.setFileTime(QDateTime::currentDateTime(),
+                  QFileDevice::FileModificationTime);
+}
+
+bool PDFCache::readEntry(const QByteArray & hash, AttributeHash * target)
+{
+  QFile f(entryPath(hash));
+  if(! f.open(QIODevice::ReadOnly))
+    return false;
+  QByteArray data = qUncompress(f.readAll());
+  QDataStream in(data);
+  quint32 format;
+  QHash<QString, QVariant> contents;
+  in >> format;
+  if(format != cacheFormat)
+    return false;
+  in >> contents;
+  if(in.status() != QDataStream::Ok)
+    return false;
+  target->clear();
+  target->unite(contents);
+  f.close();
+  touchFile(f.fileName());
+  return true;
+}
+
+qint64 PDFCache::writeEntry(const QByteArray & hash,
+                            const AttributeHash & contents)
+{
+  QByteArray data;
+  {
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << cacheFormat
+        << static_cast<const QHash<QString, QVariant> &>(contents);
+  }
+  data = qCompress(data);
+  QSaveFile f(entryPath(hash));
+  if(! f.open(QIODevice::WriteOnly))
+    return 0;
+  f.write(data);
+  if(! f.commit())
+    return 0;
+  return data.size();
+}
+
+void PDFCache::evict()
+{
+  if(totalSize >= 0 && totalSize <= maxSize)
+    return;
+
+  // Most recently used first
+  QFileInfoList entries = directory.entryInfoList(QDir::Files, QDir::Time);
+  qint64 total = 0;
+  const qint64 target = totalSize < 0 ? maxSize : maxSize - maxSize/10;
+  QSet<QByteArray> removed;
+  bool full = false;
+  for(const QFileInfo & info : entries) {
+    if(info.fileName() == "index")
+      continue;
+    if(full || total + info.size() > target) {
+      full = true;
+      if(QFile::remove(info.absoluteFilePath())) {
+        removed.insert(QByteArray::fromHex(info.fileName().toLatin1()));
+        continue;
+      }
+    }
+    total += info.size();
+  }
+  totalSize = total;
+
+  if(removed.isEmpty())
+    return;
+  QHash<QString, FileStamp>::iterator i = stamps.begin();
+  while(i != stamps.end()) {
+    if(removed.contains(i->hash))
+      i = stamps.erase(i);
+    else
+      ++i;
+  }
+  stampsDirty = true;
+}
+
+AttributeHash PDFCache::read(const QString & file)
+{
+  QFileInfo info(file);
+  QString path = info.absoluteFilePath();
+  FileStamp stamp(info);
+
+  // The entries are written atomically, so they are read without
+  // holding the mutex: only the stamps are protected.
+  AttributeHash contents;
+  QByteArray known;
+  {
+    QMutexLocker lock(&mutex);
+    loadStamps();
+    QHash<QString, FileStamp>::const_iterator i = stamps.constFind(path);
+    if(i != stamps.constEnd() && i->sameFile(stamp))
+      known = i->hash;
+  }
+  if(! known.isEmpty() && readEntry(known, &contents)) {
+    QMutexLocker lock(&mutex);
+    ++hits;
+    return contents;
+  }
+
+  // The file is new or has changed, but its contents may already be
+  // known.
+  stamp.hash = FileStamp::hashFile(path);
+  if(stamp.hash.isEmpty())
+    return PDFTools::readPDFUncached(file);
+  if(readEntry(stamp.hash, &contents)) {
+    QMutexLocker lock(&mutex);
+    ++hits;
+    addStamp(path, stamp);
+    return contents;
+  }
+
+  // Only one thread at a time writes the entry for given contents,
+  // so that its size is counted once. The entry may have been written
+  // since it was looked up above.
+  bool writer;
+  {
+    QMutexLocker lock(&mutex);
+    writer = ! writing.contains(stamp.hash);
+    if(writer)
+      writing.insert(stamp.hash);
+  }
+  if(writer && readEntry(stamp.hash, &contents)) {
+    QMutexLocker lock(&mutex);
+    writing.remove(stamp.hash);
+    ++hits;
+    addStamp(path, stamp);
+    return contents;
+  }
+
+  contents = PDFTools::readPDFUncached(file);
+  qint64 written = 0;
+  if(writer && ! contents.isEmpty())
+    written = writeEntry(stamp.hash, contents);
+
+  QMutexLocker lock(&mutex);
+  if(writer)
+    writing.remove(stamp.hash);
+  ++misses;
+  if(written > 0)
+    addStamp(path, stamp, written);
+  return contents;
+}
+
+QByteArray PDFCache::fileHash(const QString & file)
+{
+  QFileInfo info(file);
+  QString path = info.absoluteFilePath();
+  FileStamp stamp(info);
+  {
+    QMutexLocker lock(&mutex);
+    loadStamps();
+    QHash<QString, FileStamp>::const_iterator i = stamps.constFind(path);
+    if(i != stamps.constEnd() && i->sameFile(stamp))
+      return i->hash;
+  }
+  stamp.hash = FileStamp::hashFile(path);
+  if(! stamp.hash.isEmpty()) {
+    QMutexLocker lock(&mutex);
+    addStamp(path, stamp);
+  }
+  return stamp.hash;
+}
+
+int PDFCache::warm(const QString & dir)
+{
+  int nb = 0;
+  QDirIterator it(dir, QStringList() << "*.pdf", QDir::Files,
+                  QDirIterator::Subdirectories);
+  while(it.hasNext()) {
+    read(it.next());
+    ++nb;
+  }
+  flush();
+  return nb;
+}
+
+void PDFCache::clear()
+{
+  QMutexLocker lock(&mutex);
+  for(const QFileInfo & info : directory.entryInfoList(QDir::Files))
+    QFile::remove(info.absoluteFilePath());
+  stamps.clear();
+  stampsDirty = false;
+  totalSize = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/// The maximum size of the disk cache of the rendered pages, in
+/// megabytes
+static SettingsValue<int> pageCacheSize("pdf/page-cache-size", 128);
+
+/// The maximum size of the rendered pages kept in memory, in
+/// megabytes
+static SettingsValue<int> pageMemorySize("pdf/page-memory-size", 64);
+
+PageRenderer::PageRenderer(const QString & dir, QObject * parent) :
+  QObject(parent), generation(0), directory(dir),
+  maxSize(((qint64) pageCacheSize) << 20)
+{
+  directory.mkpath(".");
+  // The cost of the images is their size in kilobytes
+  memory.setMaxCost(((int) pageMemorySize) << 10);
+  // Rendering is mostly useful for the current document and the
+  // neighbouring ones.
+  pool.setMaxThreadCount(2);
+}
+
+PageRenderer::~PageRenderer()
+{
+  pool.clear();
+  pool.waitForDone();
+}
+
+PageRenderer * PageRenderer::globalRenderer()
+{
+  static PageRenderer renderer(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pages");
+  return &renderer;
+}
+
+QString PageRenderer::memoryKey(const QString & file, int page,
+                                int resolution)
+{
+  QFileInfo info(file);
+  return QString("%1:%2:%3:%4:%5").arg(info.absoluteFilePath()).
+    arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).
+    arg(page).arg(resolution);
+}
+
+QImage PageRenderer::cachedPage(const QString & file, int page,
+                                int resolution)
+{
+  QString key = memoryKey(file, page, resolution);
+  QMutexLocker lock(&mutex);
+  QImage * img = memory.object(key);
+  return img ? *img : QImage();
+}
+
+void PageRenderer::request(const QString & file, int page, int resolution)
+{
+  QString key = memoryKey(file, page, resolution);
+  int gen = generation.loadAcquire();
+  {
+    QMutexLocker lock(&mutex);
+    QImage * img = memory.object(key);
+    if(img) {
+      QImage image = *img;
+      lock.unlock();
+      emit(pageRendered(file, page, resolution, image));
+      return;
+    }
+    // Already requested since the last cancelPending()
+    if(inFlight.value(key, -1) == gen)
+      return;
+    inFlight[key] = gen;
+  }
+  QtConcurrent::run(&pool, [this, file, page, resolution, key, gen]() {
+      render(file, page, resolution, key, gen);
+    });
+}
+
+void PageRenderer::cancelPending()
+{
+  generation.fetchAndAddOrdered(1);
+  pool.clear();
+  QMutexLocker lock(&mutex);
+  inFlight.clear();
+}
+
+void PageRenderer::render(const QString & file, int page, int resolution,
+                          const QString & key, int gen)
+{
+  QImage image;
+  if(gen == generation.loadAcquire()) {
+    QByteArray hash = PDFCache::globalCache()->fileHash(file);
+    QString path;
+    if(! hash.isEmpty()) {
+      path = directory.absoluteFilePath(QString("%1-%2-%3.png").
+                                        arg(QString::fromLatin1(hash.toHex())).
+                                        arg(page).arg(resolution));
+      if(image.load(path))
+        touchFile(path);          // Keeps track of the last use, for evict()
+    }
+    if(image.isNull()) {
+      std::unique_ptr<Poppler::Document> doc(Poppler::Document::load(file));
+      if(doc && ! doc->isLocked()) {
+        std::unique_ptr<Poppler::Page> pdfPage(doc->page(page));
+        if(pdfPage)
+          image = pdfPage->renderToImage(resolution, resolution);
+      }
+      if(! image.isNull() && ! path.isEmpty()) {
+        QSaveFile f(path);
+        if(f.open(QIODevice::WriteOnly) && image.save(&f, "PNG"))
+          f.commit();
+        evict();
+      }
+    }
+  }
+
+  QMutexLocker lock(&mutex);
+  if(inFlight.value(key, -1) == gen)
+    inFlight.remove(key);
+  if(image.isNull())
+    return;
+  memory.insert(key, new QImage(image),
+                std::max(int(image.sizeInBytes() >> 10), 1));
+  lock.unlock();
+  emit(pageRendered(file, page, resolution, image));
+}
+
+void PageRenderer::evict()
+{
+  // Most recently used first
+  QFileInfoList entries = directory.entryInfoList(QDir::Files, QDir::Time);
+  qint64 total = 0;
+  for(const QFileInfo & info : entries) {
+    total += info.size();
+    if(total > maxSize)
+      QFile::remove(info.absoluteFilePath());
+  }
+}
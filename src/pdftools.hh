@@ -23,6 +23,7 @@
 
 
 #include <attributehash.hh>
+#include <filestamp.hh>
 
 /// Various PDF tools
 namespace PDFTools {
@@ -36,6 +37,193 @@ namespace PDFTools {
   /// !, and specific PDF information. The former should be done via a
   /// common function (let's think of other kinds of files).
   AttributeHash readPDF(QString file);
+
+  /// Same as readPDF(), but always extracts the text using Poppler,
+  /// without looking at the PDFCache.
+  AttributeHash readPDFUncached(const QString & file);
+};
+
+/// An on-disk cache of the contents extracted by PDFTools::readPDF(),
+/// so that the text of a given PDF file is only extracted once.
+///
+/// The entries are keyed by the SHA-1 of the contents of the file,
+/// so that moving or copying a file does not invalidate them. To
+/// avoid hashing files on every read, the FileStamp of the files
+/// already seen are kept: if their size and modification time did not
+/// change, the file is not read at all.
+///
+/// Each entry is the AttributeHash written with QDataStream and
+/// compressed using qCompress(). When the total size of the entries
+/// exceeds maxSize, the least recently used ones are removed.
+///
+/// All the public functions are thread-safe.
+class PDFCache {
+
+  /// The directory holding the entries
+  QDir directory;
+
+  /// Protects all the members
+  QMutex mutex;
+
+  /// Absolute file path -> last known stamp
+  QHash<QString, FileStamp> stamps;
+
+  /// Whether the stamps were read from the disk.
+  bool stampsLoaded;
+
+  /// Whether the stamps changed since they were last saved.
+  bool stampsDirty;
+
+  /// The total size of the entries, or -1 if it is not known yet.
+  qint64 totalSize;
+
+  /// The hashes of the entries being written by read(). Concurrent
+  /// misses on the same contents leave the writing to the first one.
+  QSet<QByteArray> writing;
+
+  /// Reads the stamps from the disk, if that hasn't been done yet.
+  void loadStamps();
+
+  /// Writes the stamps to the disk.
+  void saveStamps();
+
+  /// Records the stamp of the file, and accounts for the size of its
+  /// entry if it was just written (@a written is the size of the
+  /// entry, or 0). Must be called with the mutex held.
+  void addStamp(const QString & path, const FileStamp & stamp,
+                qint64 written = 0);
+
+  /// The path of the entry for the given hash
+  QString entryPath(const QByteArray & hash) const;
+
+  /// Reads the given entry, returning false if it does not exist or
+  /// is damaged.
+  bool readEntry(const QByteArray & hash, AttributeHash * target);
+
+  /// Writes the given entry, and returns its size (0 on failure).
+  qint64 writeEntry(const QByteArray & hash, const AttributeHash & contents);
+
+  /// Removes the least recently used entries, and their stamps, so
+  /// that the total size is 10% below maxSize. Only lists the
+  /// directory when the running total goes over maxSize. Must be
+  /// called with the mutex held.
+  void evict();
+
+public:
+
+  /// Builds a cache using the given directory, which is created if
+  /// needed.
+  explicit PDFCache(const QString & directory);
+
+  /// Saves the stamps.
+  ~PDFCache();
+
+  /// The maximum total size of the entries, in bytes.
+  qint64 maxSize;
+
+  /// The number of reads that were served from the cache.
+  int hits;
+
+  /// The number of reads that required extracting the text.
+  int misses;
+
+  /// Returns the contents of the given file, extracting them only if
+  /// they are not in the cache yet.
+  AttributeHash read(const QString & file);
+
+  /// Returns the SHA-1 of the contents of the file, only reading the
+  /// file if it is new or has changed.
+  QByteArray fileHash(const QString & file);
+
+  /// Makes sure all the PDF files in the given directory (and its
+  /// subdirectories) are in the cache. Returns the number of files
+  /// found.
+  int warm(const QString & directory);
+
+  /// Removes all the entries.
+  void clear();
+
+  /// Writes the stamps to the disk, if they changed. This is done at
+  /// destruction, and should be done after processing many files.
+  void flush();
+
+  /// The cache used by PDFTools::readPDF(), stored in the standard
+  /// cache location.
+  static PDFCache * globalCache();
+};
+
+/// Renders the pages of PDF files in background threads, keeping the
+/// images in a memory cache and in a disk cache.
+///
+/// The images on disk are keyed by the hash of the contents of the
+/// file (see PDFCache::fileHash()), the page and the resolution, and
+/// the least recently used ones are removed when they take more than
+/// maxSize. The memory cache is keyed by the file name, size and
+/// modification time, so that looking into it does not require
+/// reading the file.
+///
+/// When a request cannot be served from the memory cache, the page is
+/// rendered (or read from the disk cache) in the background, and
+/// pageRendered() is emitted when it is ready. cancelPending() drops
+/// all the requests that have not started yet.
+class PageRenderer : public QObject {
+  Q_OBJECT;
+
+  /// The threads doing the rendering
+  QThreadPool pool;
+
+  /// Protects memory and inFlight
+  QMutex mutex;
+
+  QCache<QString, QImage> memory;
+
+  /// Memory key -> generation of the requests submitted and not done
+  QHash<QString, int> inFlight;
+
+  /// Incremented by cancelPending()
+  QAtomicInt generation;
+
+  /// The directory of the disk cache
+  QDir directory;
+
+  /// The key for the memory cache
+  static QString memoryKey(const QString & file, int page, int resolution);
+
+  /// Renders the page, or reads it from the disk. Runs in the pool.
+  void render(const QString & file, int page, int resolution,
+              const QString & key, int gen);
+
+  /// Removes the least recently used images from the disk
+  void evict();
+
+public:
+
+  explicit PageRenderer(const QString & directory, QObject * parent = NULL);
+  virtual ~PageRenderer();
+
+  /// The maximum total size of the images on disk, in bytes.
+  qint64 maxSize;
+
+  /// Returns the image if it is in the memory cache, or a null image.
+  QImage cachedPage(const QString & file, int page, int resolution);
+
+  /// Asks for the given page of the file (an absolute path), at the
+  /// given resolution (in dots per inch). If it is in the memory
+  /// cache, pageRendered() is emitted before returning.
+  void request(const QString & file, int page, int resolution);
+
+  /// Drops all the requests not started yet, for instance because the
+  /// user has selected another document.
+  void cancelPending();
+
+  /// The renderer storing its images in the standard cache location.
+  static PageRenderer * globalRenderer();
+
+signals:
+
+  /// Emitted when the page is available.
+  void pageRendered(const QString & file, int page, int resolution,
+                    const QImage & image);
 };
 
 #endif
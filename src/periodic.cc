@@ -22,6 +22,8 @@
 #include <serialization.hh>
 #include <utils.hh>
 
+#include <climits>
+
 Period::Period()
 {
 }
@@ -45,7 +47,10 @@ bool Period::isValid() const
 
 uint qHash(const Period & p, uint seed)
 {
-  return qHash(p.startDate) ^ qHash(p.endDate) ^ seed;
+  // Both dates are within a few million days, so their julian day
+  // numbers fit together in one 64-bit integer.
+  return qHash((quint64(p.startDate.toJulianDay()) << 32) ^
+               quint64(p.endDate.toJulianDay()), seed);
 }
 
 bool Period::operator<(const Period & other) const
@@ -121,22 +126,52 @@ Periodic::Periodic(int m, int fm) :
 
 Period Periodic::periodForDate(const QDate & date) const
 {
-  Period rv;
   if(! date.isValid())
-    return rv; // invalid period
-  int year = date.year();
-  int month = date.month();
-  if(month < firstMonth) {
-    year -= 1;
-    month += 12;
-  }
-  
-  month -= (month - firstMonth) % months;
-  rv.startDate.setDate(year, month, 1);
+    return Period(); // invalid period
+  return periodFromID(periodID(date));
+}
+
+const int Periodic::invalidPeriodID = INT_MIN;
+
+// The periods restart at firstMonth every year, so there are
+// ceil(12/months) periods every year (the last one may overlap with
+// the first of the next year when months does not divide 12).
+
+int Periodic::periodIDForMonthID(int monthID) const
+{
+  int perYear = (11 + months)/months;
+  // The month counted from the first month of year 0
+  int m = monthID - (firstMonth - 1);
+  int year = m >= 0 ? m/12 : -((11 - m)/12);
+  return year * perYear + (m - 12 * year)/months;
+}
+
+int Periodic::periodID(const QDate & date) const
+{
+  if(! date.isValid())
+    return invalidPeriodID;
+  return periodIDForMonthID(date.month() - 1 + date.year() * 12);
+}
+
+Period Periodic::periodFromID(int id) const
+{
+  Period rv;
+  if(id == invalidPeriodID)
+    return rv;
+  int perYear = (11 + months)/months;
+  int year = id >= 0 ? id/perYear : -((perYear - 1 - id)/perYear);
+  int start = year * 12 + firstMonth - 1 + (id - year * perYear) * months;
+  rv.startDate.setDate(start/12, start % 12 + 1, 1);
   rv.endDate = rv.startDate.addMonths(months).addDays(-1);
   return rv;
 }
 
+QPair<int, int> Periodic::periodIDs(const Period & period) const
+{
+  return QPair<int, int>(periodID(period.startDate),
+                         periodID(period.endDate));
+}
+
 Period Periodic::nextPeriod(const Period & period) const
 {
   Period rv;
@@ -108,6 +108,35 @@ public:
   /// Returns the period that contains the given date
   Period periodForDate(const QDate & date) const;
 
+  /// @name Period IDs
+  ///
+  /// The periods generated by periodForDate() can be represented by
+  /// consecutive integers, derived from AtomicTransaction::monthID()
+  /// by integer arithmetic only. They are much cheaper to compute,
+  /// hash and compare than Period objects, and ranges of periods are
+  /// just ranges of integers.
+  ///
+  /// @{
+
+  /// Returns the ID of the period containing the given month ID
+  int periodIDForMonthID(int monthID) const;
+
+  /// Returns the ID of the period containing the date, or
+  /// invalidPeriodID if the date is invalid.
+  int periodID(const QDate & date) const;
+
+  /// Returns the Period corresponding to the given ID. It is the same
+  /// as the one returned by periodForDate().
+  Period periodFromID(int id) const;
+
+  /// The IDs of the first and last periods that overlap the given
+  /// Period.
+  QPair<int, int> periodIDs(const Period & period) const;
+
+  static const int invalidPeriodID;
+
+  /// @}
+
   /// Return the next period. Assumes the given Period was either
   /// given by a call to periodForDate() or nextPeriod().
   Period nextPeriod(const Period & period) const;
@@ -50,41 +50,130 @@ QList<CategorizedStatistics::Item> CategorizedStatistics::categorize() const
 //////////////////////////////////////////////////////////////////////
 
 
-PeriodicCategorizedStatistics::PeriodicCategorizedStatistics(const QList<Account *>& ac, const Periodic & periodic) :
-  accounts(ac), periodicity(periodic)
+CategoryMonthCube::CategoryMonthCube() :
+  firstMonthID(0), months(0)
 {
-  wallet = (accounts.size() > 0 && accounts.first() ? accounts.first()->wallet : NULL);
 }
 
-/// Adds a Transaction to the statistics.
-void PeriodicCategorizedStatistics::addTransaction(const AtomicTransaction * t, 
-                                                   bool topLevel)
+void CategoryMonthCube::fill(const TransactionPtrList & lst, bool topLevel)
 {
-  Period p = periodicity.periodForDate(t->getDate());
-  (*this)[p].addTransaction(t, topLevel);
-}
+  categories.clear();
+  cells.clear();
+  monthCounts.clear();
+  months = 0;
+
+  // First, we find out the month range and number the categories,
+  // keeping the month and category of each transaction
+  QHash<const Category *, int> categoryIndices;
+  QVector<int> monthIDs(lst.size());
+  QVector<int> categoryIndex(lst.size());
+  int lastMonthID = -1;
+  for(int i = 0; i < lst.size(); i++) {
+    const AtomicTransaction * t = lst[i];
+    QDate date = t->getDate();
+    if(! date.isValid()) {
+      monthIDs[i] = -1;
+      continue;
+    }
+    int mid = AtomicTransaction::monthID(date);
+    monthIDs[i] = mid;
+    if(lastMonthID < 0) {
+      firstMonthID = mid;
+      lastMonthID = mid;
+    }
+    else {
+      firstMonthID = std::min(firstMonthID, mid);
+      lastMonthID = std::max(lastMonthID, mid);
+    }
+
+    // We ignored transactions flagged as internal move
+    if(t->hasNamedLinks("internal move")) {
+      categoryIndex[i] = -1;
+      continue;
+    }
+    const Category * cat = t->getCategory();
+    if(cat && topLevel)
+      cat = cat->topLevelCategory();
+    QHash<const Category *, int>::const_iterator j =
+      categoryIndices.constFind(cat);
+    if(j == categoryIndices.constEnd()) {
+      categoryIndex[i] = categories.size();
+      categoryIndices[cat] = categories.size();
+      categories << cat;
+    }
+    else
+      categoryIndex[i] = j.value();
+  }
+  if(lastMonthID < 0)
+    return;
 
+  // Then, we accumulate
+  months = lastMonthID - firstMonthID + 1;
+  int nbc = categories.size();
+  cells.resize(months * nbc);
+  monthCounts.fill(0, months);
+  for(int i = 0; i < lst.size(); i++) {
+    if(monthIDs[i] < 0)
+      continue;
+    int month = monthIDs[i] - firstMonthID;
+    ++monthCounts[month];
+    if(categoryIndex[i] < 0)
+      continue;
+    Cell & c = cells[month * nbc + categoryIndex[i]];
+    c.amount += lst[i]->getAmount();
+    ++c.number;
+  }
+}
 
+QList<Period> CategoryMonthCube::periods(const Periodic & periodicity) const
+{
+  QList<Period> rv;
+  int last = Periodic::invalidPeriodID;
+  for(int i = 0; i < months; i++) {
+    if(monthCounts[i] == 0)
+      continue;
+    int id = periodicity.periodIDForMonthID(firstMonthID + i);
+    if(id == last)
+      continue;
+    rv << periodicity.periodFromID(id);
+    last = id;
+  }
+  return rv;
+}
 
-/// @todo Using TransactionList for that really isn't the right thing
-/// to do !
-QHash<QString, TransactionList> PeriodicCategorizedStatistics::listsForDisplay() const
+QList<CategorizedStatistics::Item> CategoryMonthCube::categorize(const Period & period) const
 {
-  QHash<QString, TransactionList> ret;
-  // QList<int> ks = keys();
-  // qSort(ks);
-
-  // for(int i = 0; i < ks.size(); i++) {
-  //   QList<CategorizedStatistics::Item> lst = value(ks[i]).categorize();
-  //   for(int j = 0; j < lst.size(); j++) {
-  //     ret[lst[j].category].
-  //       append(Transaction(dateOfBucket(ks[i]), lst[j].amount));
-  //   }
-  // }
-  return ret;
+  QList<CategorizedStatistics::Item> retval;
+  int nbc = categories.size();
+  QVector<Cell> sums(nbc);
+  int first = std::max(0, AtomicTransaction::monthID(period.startDate) -
+                       firstMonthID);
+  int last = std::min(months - 1, AtomicTransaction::monthID(period.endDate) -
+                      firstMonthID);
+  for(int m = first; m <= last; m++) {
+    const Cell * row = cells.constData() + m * nbc;
+    for(int c = 0; c < nbc; c++) {
+      sums[c].amount += row[c].amount;
+      sums[c].number += row[c].number;
+    }
+  }
+  for(int c = 0; c < nbc; c++) {
+    if(sums[c].number > 0)
+      retval.append(CategorizedStatistics::Item(categories[c],
+                                                sums[c].amount));
+  }
+  // Behaviour change: items with the same amount stay in the order
+  // the categories were first met in the list. With
+  // CategorizedStatistics::categorize(), their order depended on the
+  // QHash iteration order, and changed from a run to another.
+  std::stable_sort(retval.begin(), retval.end());
+  return retval;
 }
 
-QString PeriodicCategorizedStatistics::elementName(const Period & period) const
+//////////////////////////////////////////////////////////////////////
+
+QString Statistics::elementName(const Periodic & periodicity,
+                                const Period & period) const
 {
   QList<Account * > acs = accounts;
   return HTTarget::
@@ -94,9 +183,9 @@ QString PeriodicCategorizedStatistics::elementName(const Period & period) const
                    });
 }
 
-QString PeriodicCategorizedStatistics::categoryName(const Period & period,
-                                                    const QString & name,
-                                                    const QString & disp) const
+QString Statistics::categoryName(const Period & period,
+                                 const QString & name,
+                                 const QString & disp) const
 {
   QList<Account * > acs = accounts;
   Category * cat = wallet->namedCategory(name);
@@ -110,6 +199,16 @@ QString PeriodicCategorizedStatistics::categoryName(const Period & period,
 
 //////////////////////////////////////////////////////////////////////
 
+QHash<QString, Periodic> Statistics::periodicities()
+{
+  QHash<QString, Periodic> rv;
+  rv["monthly"] = Periodic::monthly;
+  rv["trimester"] = Periodic::trimester;
+  rv["yearly"] = Periodic::yearly;
+  rv["schoolyear"] = Periodic::schoolYear;
+  return rv;
+}
+
 Statistics::Statistics(const TransactionPtrList & lst, bool topLevel)
 {
   QSet<Account *> acs;
@@ -118,50 +217,36 @@ Statistics::Statistics(const TransactionPtrList & lst, bool topLevel)
     if(ac)
       acs << ac;
   }
-        
-  stats["monthly"] =
-    new PeriodicCategorizedStatistics(acs.toList(), Periodic::monthly); 
-  stats["trimester"] =
-    new PeriodicCategorizedStatistics(acs.toList(), Periodic::trimester); 
-  stats["yearly"] =
-    new PeriodicCategorizedStatistics(acs.toList(), Periodic::yearly); 
-  stats["schoolyear"] =
-    new PeriodicCategorizedStatistics(acs.toList(), Periodic::schoolYear); 
-
-  for(int i = 0; i < lst.size(); i++) {
-    for(auto j = stats.begin() ; j != stats.end(); j++) {
-      (*j)->addTransaction(lst[i], topLevel);
-    }
-  }
-}
+  accounts = acs.toList();
+  wallet = (accounts.size() > 0 && accounts.first() ? accounts.first()->wallet : NULL);
 
-Statistics::~Statistics()
-{
-  for(auto i = stats.begin(); i != stats.end(); i++)
-    delete *i;
+  cube.fill(lst, topLevel);
 }
 
 
 /// @todo This is a good idea, but maybe it should be up to the user
 /// to choose whether we're displaying the average or the sum.
-QString Statistics::htmlStatistics(PeriodicCategorizedStatistics * which,
+QString Statistics::htmlStatistics(const Periodic & periodicity,
                                    int number, int maxDisplay, 
                                    bool monthlyAverage) const
 {
   QList<QStringList> columns;
-  QList<Period> periods = which->keys();
-  qSort(periods);
+  QList<Period> periods = cube.periods(periodicity);
   // int div = (monthlyAverage ? which->monthNumber() : 1);
   int div = 1;
   for(auto i = periods.rbegin(); i != periods.rend(); i++) {
+    QList<CategorizedStatistics::Item> items = cube.categorize(*i);
+    // Behaviour change: a period holding only internal moves has no
+    // items. It used to be shown, reading items.last() of an empty
+    // list (undefined behaviour); it is now left out of the table.
+    if(items.isEmpty())
+      continue;
+
     QStringList c1, c2;
-    c1 << QString("<b>%1</b>").arg(which->elementName(*i));
+    c1 << QString("<b>%1</b>").arg(elementName(periodicity, *i));
     c2 << "";
-    QList<CategorizedStatistics::Item> items = 
-      (*which)[*i].categorize();
-
 
-    c1 << which->categoryName(*i, items.last().category, "Revenues");
+    c1 << categoryName(*i, items.last().category, "Revenues");
     c2 << Transaction::formatAmount(items.last().amount/div);
 
     int rest = 0;
@@ -179,7 +264,7 @@ QString Statistics::htmlStatistics(PeriodicCategorizedStatistics * which,
     c2 << Transaction::formatAmount(rest/div);
 
     for(int j = 0; j < std::min(items.size(), maxDisplay); j++) {
-      c1 << which->categoryName(*i, items[j].category);
+      c1 << categoryName(*i, items[j].category);
       c2 << Transaction::formatAmount(items[j].amount/div);
     }
     columns << c1 << c2;
@@ -213,6 +298,7 @@ QString Statistics::htmlStatistics(PeriodicCategorizedStatistics * which,
 QString Statistics::htmlStatistics(const QString & which, int months, 
                                    int maxDisplay, bool monthlyAverage) const
 {
-  return htmlStatistics(stats[which], months, maxDisplay, monthlyAverage);
+  return htmlStatistics(periodicities().value(which, Periodic::monthly),
+                        months, maxDisplay, monthlyAverage);
 }
 
@@ -58,73 +58,110 @@ public:
 };
 
 
-/// This abstract class handles categorized statistics
-class PeriodicCategorizedStatistics : 
-  public QHash<Period, CategorizedStatistics> {
+/// A dense month × category array of amounts, filled in a single
+/// pass over a list of transactions. Statistics over longer periods
+/// (trimesters, years...) are obtained by rolling up the months,
+/// rather than by computing the Period of each transaction for each
+/// Periodic.
+class CategoryMonthCube {
+public:
+
+  /// The contents of one month for one category.
+  class Cell {
+  public:
+    /// The total amount
+    int amount = 0;
+
+    /// The number of transactions
+    int number = 0;
+  };
+
 protected:
-  QList<Account *> accounts;
 
-  Wallet * wallet;
+  /// The month ID of the first month
+  int firstMonthID;
 
-  /// The underlying periodicity
-  Periodic periodicity;
-public:
+  /// The number of months
+  int months;
 
-  PeriodicCategorizedStatistics(const QList<Account *> &ac, const Periodic & periodic);
-  virtual ~PeriodicCategorizedStatistics() {;};
+  /// The categories, indexed by their position in the cube. It may
+  /// contain NULL, for uncategorized transactions.
+  QVector<const Category *> categories;
 
-  /// Adds a Transaction to the statistics.
-  void addTransaction(const AtomicTransaction * t, 
-                              bool topLevel = true);
+  /// The cells, indexed by month * categories.size() + category
+  QVector<Cell> cells;
 
-  /// The name for one element, crosslinked to the 
-  QString elementName(const Period & period) const;
+  /// The number of transactions for each month, including the ones
+  /// that are not taken into account in the cells (internal moves).
+  QVector<int> monthCounts;
 
-  /// Formats a category name
-  QString categoryName(const Period & period, const QString & name,
-                               const QString & display = "") const;
+public:
+
+  CategoryMonthCube();
+
+  /// Fills the cube from the given list. If @a topLevel is true, the
+  /// transactions are sorted by top-level categories.
+  ///
+  /// Transactions flagged as internal moves are not counted.
+  void fill(const TransactionPtrList & lst, bool topLevel = true);
 
-  /// Returns a category name -> TransactionList hash that can be used
-  /// for display purposes (and that wouldn't be much use else
-  /// anyway...)
-  QHash<QString, TransactionList> listsForDisplay() const;
+  /// Returns the (sorted) list of the periods of the given
+  /// periodicity containing at least one transaction.
+  QList<Period> periods(const Periodic & periodicity) const;
+
+  /// Rolls up the months of the given period, and returns a sorted
+  /// list of items, just like CategorizedStatistics::categorize().
+  QList<CategorizedStatistics::Item> categorize(const Period & period) const;
 };
 
 /// This class computes up various statistics about a series of
 /// transactions: it organizes them by month and top-level categories.
 class Statistics {
-  /// The target account.
-  Account * account;
+
+  /// The accounts the transactions come from
+  QList<Account *> accounts;
+
+  /// The wallet of the accounts
+  Wallet * wallet;
+
+  /// The underlying data
+  CategoryMonthCube cube;
 
 protected:
 
-  QString htmlStatistics(PeriodicCategorizedStatistics * which, int months = 5,
+  /// The name for one element, crosslinked to the list of
+  /// transactions.
+  QString elementName(const Periodic & periodicity,
+                      const Period & period) const;
+
+  /// Formats a category name
+  QString categoryName(const Period & period, const QString & name,
+                       const QString & display = "") const;
+
+  QString htmlStatistics(const Periodic & periodicity, int months = 5,
                          int maxDisplay = 6, bool monthlyAverage = false) const;
 
 public:
 
-  /// All different statistics
-  QHash<QString, PeriodicCategorizedStatistics *> stats;
+  /// All the different periodicities, by name.
+  static QHash<QString, Periodic> periodicities();
 
   /// Creates statistics from a transaction list.
   Statistics(const TransactionPtrList & lst, bool topLevel = true);
 
-
-
-
   /// Returns a HTML string suitable for representing statistics of
   /// the given number of months. Returns the stats in form of a HTML
   /// table. If months is negative, returns the stats for all the
   /// months.
   ///
+  /// @a which is one of the keys of periodicities().
+  ///
   /// @todo Idea: graphics display (possibly by alternance) where
   /// each data point would be very visible, with a neat tooltip and a
   /// context menu for showing transactions ?
   QString htmlStatistics(const QString & which, int months = 5, 
                          int maxDisplay = 6, 
                          bool monthlyAverage = false) const;
-
-  ~Statistics();
 };
 
 
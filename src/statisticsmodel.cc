@@ -19,9 +19,30 @@
 #include <headers.hh>
 #include <statisticsmodel.hh>
 
-StatisticsModel::StatisticsModel()
+/// The approximate memory footprint of the statistics, for
+/// ItemCache.
+static int statisticsCost(const TransactionListStatistics * s)
+{
+  return sizeof(*s) + (s->monthlyStats.size() + s->yearlyStats.size()) *
+    (sizeof(BasicStatistics) + 2 * sizeof(int));
+}
+
+/// The approximate memory footprint of the daily statistics, for
+/// ItemCache.
+static int dailyStatisticsCost(const DailyStatistics * s)
+{
+  return sizeof(*s) + s->days() * 32;
+}
+
+/// The approximate memory footprint of the list, for ItemCache.
+static int listCost(const TransactionVector * l)
+{
+  return sizeof(*l) + l->size() * sizeof(AtomicTransaction *);
+}
+
+StatisticsModel::StatisticsModel(Wallet * w) :
+  wallet(w)
 {
-  // nothing to do for now.
 }
 
 int StatisticsModel::columnCount(const QModelIndex & /*index*/) const
@@ -29,19 +50,48 @@ int StatisticsModel::columnCount(const QModelIndex & /*index*/) const
   return LastColumn;
 }
 
-TransactionListStatistics * StatisticsModel::statsForItem(const QModelIndex & idx) const
+QSharedPointer<TransactionListStatistics> StatisticsModel::statsForItem(const QModelIndex & idx) const
 {
-  TransactionPtrList * transactions = transactionsForItem(idx);
-  if(! transactions)
-    return NULL;
+  const void * key = idx.internalPointer();
+  if(! key)
+    return QSharedPointer<TransactionListStatistics>();
+
+  QSharedPointer<TransactionListStatistics> ret =
+    stats.find(key, lastChange(idx));
+  if(ret)
+    return ret;
+
+  quint64 stamp = wallet->aggregates.currentStamp();
+  TransactionListStatistics * s = computeStatistics(idx);
+  if(! s)
+    return QSharedPointer<TransactionListStatistics>();
+  return stats.insert(key, s, stamp, statisticsCost(s));
+}
+
+QSharedPointer<DailyStatistics> StatisticsModel::dailyStatsForItem(const QModelIndex & idx) const
+{
+  const void * key = idx.internalPointer();
+  if(! key)
+    return QSharedPointer<DailyStatistics>();
+
+  QSharedPointer<DailyStatistics> ret = dailyStats.find(key, lastChange(idx));
+  if(ret)
+    return ret;
 
-  if(stats.contains(transactions))
-    return stats[transactions];
+  quint64 stamp = wallet->aggregates.currentStamp();
+  QSharedPointer<TransactionVector> transactions = transactionsForItem(idx);
+  if(! transactions)
+    return QSharedPointer<DailyStatistics>();
+  DailyStatistics * s = new DailyStatistics(transactions->dailyStatistics());
+  return dailyStats.insert(key, s, stamp, dailyStatisticsCost(s));
+}
 
-  TransactionListStatistics * s = 
-    new TransactionListStatistics(transactions->statistics());
-  stats.insert(transactions, s);
-  return s;
+TransactionListStatistics * StatisticsModel::computeStatistics(const QModelIndex & idx) const
+{
+  QSharedPointer<TransactionVector> transactions = transactionsForItem(idx);
+  if(! transactions)
+    return NULL;
+  return new TransactionListStatistics(transactions->statistics());
 }
 
 
@@ -65,6 +115,8 @@ QVariant StatisticsModel::headerData(int section,
     case MonthBeforeColumn: 
       return QVariant(now.addMonths(-2).toString(tr("MMM yy")));
     case AverageMonthColumn: return QVariant(tr("Monthly average"));
+    case Running7DaysColumn: return QVariant(tr("Last 7 days"));
+    case Running30DaysColumn: return QVariant(tr("Last 30 days"));
 
     case CurrentYearColumn: 
       return QString("%1").arg(now.year());
@@ -83,7 +135,7 @@ QVariant StatisticsModel::headerData(int section,
 
 QVariant StatisticsModel::data(const QModelIndex& index, int role) const
 {
-  TransactionListStatistics * stats = statsForItem(index);
+  QSharedPointer<TransactionListStatistics> stats = statsForItem(index);
   if(! stats)
     return QVariant();
   QDate now = QDate::currentDate();
@@ -106,6 +158,15 @@ QVariant StatisticsModel::data(const QModelIndex& index, int role) const
     case AverageMonthColumn:
       return formatAmount(stats->monthlyAverageAmount());
 
+    case Running7DaysColumn:
+    case Running30DaysColumn: {
+      QSharedPointer<DailyStatistics> daily = dailyStatsForItem(index);
+      if(! daily)
+        return QVariant();
+      return formatAmount(daily->lastDays(index.column() == Running7DaysColumn ?
+                                          7 : 30).totalAmount);
+    }
+
     case CurrentYearColumn:
       return formatAmount(stats->yearlyStats[now.year()].totalAmount);
     case LastYearColumn:
@@ -131,6 +192,8 @@ QVariant StatisticsModel::data(const QModelIndex& index, int role) const
     case CreditColumn:
     case MonthBeforeColumn:
     case YearBeforeColumn:
+    case Running7DaysColumn:
+    case Running30DaysColumn:
       return QVariant(Qt::AlignRight);
     default:
       return QVariant();
@@ -143,7 +206,7 @@ QVariant StatisticsModel::data(const QModelIndex& index, int role) const
 //////////////////////////////////////////////////////////////////////
 
 CategoryModel::CategoryModel(Wallet * w) :
-  wallet(w)
+  StatisticsModel(w)
 {
 }
 
@@ -161,23 +224,34 @@ CategoryHash * CategoryModel::indexedCategoryHash(const QModelIndex &index) cons
     return &wallet->categories;
 }
 
-TransactionPtrList * CategoryModel::transactionsForItem(const QModelIndex & idx) const
+QSharedPointer<TransactionVector> CategoryModel::transactionsForItem(const QModelIndex & idx) const
 {
   Category * c = indexedCategory(idx);
   if(! c)
-    return NULL;
+    return QSharedPointer<TransactionVector>();
+
+  QSharedPointer<TransactionVector> ret = cachedLists.find(c, lastChange(idx));
+  if(ret)
+    return ret;
 
-  /// @todo Cache never gets invalidated... That's pretty bad ;-)...
-  if(cachedLists.contains(c)) 
-    return cachedLists[c];
+  quint64 stamp = wallet->aggregates.currentStamp();
+  TransactionVector * trs =
+    new TransactionVector(wallet->categorizationIndex.categoryTransactions(c));
+  return cachedLists.insert(c, trs, stamp, listCost(trs));
+}
 
-  TransactionPtrList * trs = 
-    new TransactionPtrList(wallet->categoryTransactions(c));
-  cachedLists.insert(c, trs);
-  return trs;
-  
+quint64 CategoryModel::lastChange(const QModelIndex & idx) const
+{
+  return wallet->aggregates.categoryStamp(indexedCategory(idx));
 }
 
+TransactionListStatistics * CategoryModel::computeStatistics(const QModelIndex & idx) const
+{
+  Category * c = indexedCategory(idx);
+  if(! c)
+    return NULL;
+  return new TransactionListStatistics(wallet->aggregates.categoryStatistics(c));
+}
 
 QModelIndex CategoryModel::index(int row, int column,
 				 const QModelIndex & parent) const
@@ -245,7 +319,7 @@ QVariant CategoryModel::data(const QModelIndex& index, int role) const
 //////////////////////////////////////////////////////////////////////
 
 TagModel::TagModel(Wallet * w) :
-  wallet(w)
+  StatisticsModel(w)
 {
 }
 
@@ -263,23 +337,34 @@ TagHash * TagModel::indexedTagHash(const QModelIndex &index) const
     return &wallet->tags;
 }
 
-TransactionPtrList * TagModel::transactionsForItem(const QModelIndex & idx) const
+QSharedPointer<TransactionVector> TagModel::transactionsForItem(const QModelIndex & idx) const
 {
   Tag * c = indexedTag(idx);
   if(! c)
-    return NULL;
+    return QSharedPointer<TransactionVector>();
+
+  QSharedPointer<TransactionVector> ret = cachedLists.find(c, lastChange(idx));
+  if(ret)
+    return ret;
 
-  /// @todo Cache never gets invalidated... That's pretty bad ;-)...
-  if(cachedLists.contains(c)) 
-    return cachedLists[c];
+  quint64 stamp = wallet->aggregates.currentStamp();
+  TransactionVector * trs =
+    new TransactionVector(wallet->categorizationIndex.taggedTransactions(c));
+  return cachedLists.insert(c, trs, stamp, listCost(trs));
+}
 
-  TransactionPtrList * trs = 
-    new TransactionPtrList(wallet->taggedTransactions(c));
-  cachedLists.insert(c, trs);
-  return trs;
-  
+quint64 TagModel::lastChange(const QModelIndex & idx) const
+{
+  return wallet->aggregates.tagStamp(indexedTag(idx));
 }
 
+TransactionListStatistics * TagModel::computeStatistics(const QModelIndex & idx) const
+{
+  Tag * t = indexedTag(idx);
+  if(! t)
+    return NULL;
+  return new TransactionListStatistics(wallet->aggregates.tagStatistics(t));
+}
 
 QModelIndex TagModel::index(int row, int column,
 				 const QModelIndex & parent) const
@@ -23,6 +23,58 @@
 
 #include <wallet.hh>
 
+/// A LRU cache of values computed for model items, bounded by an
+/// approximate memory budget. Each entry remembers the
+/// AggregateCube::currentStamp() at which it was computed, so that
+/// entries older than the last change of what they depend on are
+/// discarded.
+///
+/// Values are handed out as shared pointers, so that they stay valid
+/// even if the cache evicts them while they are in use.
+template <class K, class T> class ItemCache {
+  class Entry {
+  public:
+    QSharedPointer<T> value;
+    quint64 stamp;
+  };
+
+  QCache<K, Entry> entries;
+
+public:
+
+  ItemCache(int budget = 4 << 20) {
+    entries.setMaxCost(budget);
+  };
+
+  /// Returns the value for the given key, or a null pointer if there
+  /// isn't one or if it is older than @a lastChange.
+  QSharedPointer<T> find(const K & key, quint64 lastChange) {
+    Entry * e = entries.object(key);
+    if(e && e->stamp >= lastChange)
+      return e->value;
+    if(e)
+      entries.remove(key);
+    return QSharedPointer<T>();
+  };
+
+  /// Stores the value computed at the given stamp, whose size is
+  /// about @a cost bytes. Takes ownership of @a value.
+  QSharedPointer<T> insert(const K & key, T * value,
+                           quint64 stamp, int cost) {
+    Entry * e = new Entry;
+    e->value.reset(value);
+    e->stamp = stamp;
+    QSharedPointer<T> ret = e->value;
+    // QCache would delete right away an entry above the budget
+    entries.insert(key, e, std::min(cost, entries.maxCost()));
+    return ret;
+  };
+
+  void clear() {
+    entries.clear();
+  };
+};
+
 /// This superclass simply handles the display of statistics about
 /// item lists. As far as the first column isn't concerned, the
 /// derived classes just have to reimplement 
@@ -42,22 +94,41 @@ protected:
     return QString("");
   };
   
-  /// A cache for the statistics. Based on the pointer value, with the
-  /// implicit assumption that objects are in fact immutable...
-  mutable QCache<TransactionPtrList *, TransactionListStatistics> stats;
+  /// The Wallet whose categories or tags we'll display.
+  Wallet * wallet;
+
+  /// A cache for the statistics, based on the internal pointer of the
+  /// index.
+  mutable ItemCache<const void *, TransactionListStatistics> stats;
+
+  /// A cache for the daily statistics, used for the running columns.
+  mutable ItemCache<const void *, DailyStatistics> dailyStats;
+
+  /// Gets the daily statistics for the given item, caching them if
+  /// necessary. They are built from transactionsForItem().
+  QSharedPointer<DailyStatistics> dailyStatsForItem(const QModelIndex & idx) const;
 
   /// Gets the stats for the given item, caching them if necessary
-  /// (NULL is returned in case of problems). 
-  TransactionListStatistics * statsForItem(const QModelIndex & idx) const;
+  /// (a null pointer is returned in case of problems).
+  QSharedPointer<TransactionListStatistics> statsForItem(const QModelIndex & idx) const;
+
+  /// Computes the statistics for the given item, or returns NULL if
+  /// there are none. The default implementation uses
+  /// transactionsForItem().
+  virtual TransactionListStatistics * computeStatistics(const QModelIndex & idx) const;
+
+  /// Returns the AggregateCube stamp of the last change to the
+  /// transactions of the given item.
+  virtual quint64 lastChange(const QModelIndex & idx) const = 0;
 
 public:
 
-  StatisticsModel();
-  
-  /// Returns a pointer to the list corresponding to the given index,
-  /// or NULL if there is no list. Doesn't take ownership of the list
-  /// (but caches the results, of course...)
-  virtual TransactionPtrList * transactionsForItem(const QModelIndex & idx) const = 0;
+  StatisticsModel(Wallet * wallet);
+
+  /// Returns the list corresponding to the given index, or a null
+  /// pointer if there is no list. The list is cached, and shared with
+  /// the cache.
+  virtual QSharedPointer<TransactionVector> transactionsForItem(const QModelIndex & idx) const = 0;
   
 
 
@@ -96,9 +167,6 @@ class CategoryModel : public StatisticsModel {
 
   Q_OBJECT;
 
-  /// The Wallet whose categories we'll display.
-  Wallet * wallet;
-
 protected:
 
 
@@ -107,11 +175,16 @@ protected:
   CategoryHash * indexedCategoryHash(const QModelIndex &index) const;
 
   /// A cache for the transaction lists
-  mutable QCache<Category *, TransactionPtrList> cachedLists;
+  mutable ItemCache<Category *, TransactionVector> cachedLists;
+
+  /// Uses Wallet::aggregates
+  virtual TransactionListStatistics * computeStatistics(const QModelIndex & idx) const override;
+
+  virtual quint64 lastChange(const QModelIndex & idx) const override;
 
 public:
 
-  virtual TransactionPtrList * transactionsForItem(const QModelIndex & idx) const;
+  virtual QSharedPointer<TransactionVector> transactionsForItem(const QModelIndex & idx) const;
 
   /// Returns the category corresponding to the index, or NULL for
   /// root/invalid
@@ -140,20 +213,22 @@ class TagModel : public StatisticsModel {
 
   Q_OBJECT;
 
-  /// The Wallet whose categories we'll display.
-  Wallet * wallet;
-
 protected:
 
 
   /// A cache for the transaction lists
-  mutable QCache<Tag *, TransactionPtrList> cachedLists;
+  mutable ItemCache<Tag *, TransactionVector> cachedLists;
 
   TagHash * indexedTagHash(const QModelIndex &index) const;
 
+  /// Uses Wallet::aggregates
+  virtual TransactionListStatistics * computeStatistics(const QModelIndex & idx) const override;
+
+  virtual quint64 lastChange(const QModelIndex & idx) const override;
+
 public:
 
-  virtual TransactionPtrList * transactionsForItem(const QModelIndex & idx) const;
+  virtual QSharedPointer<TransactionVector> transactionsForItem(const QModelIndex & idx) const;
 
   /// Returns the category corresponding to the index, or NULL for
   /// root/invalid
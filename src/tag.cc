@@ -20,60 +20,232 @@
 #include <tag.hh>
 #include <wallet.hh>
 
+quint64 & TagSet::wordRef(int i)
+{
+  if(i == 0)
+    return first;
+  if(rest.size() < i)
+    rest.resize(i);
+  return rest[i-1];
+}
+
+void TagSet::insert(int id)
+{
+  if(id < 0)
+    return;
+  wordRef(id >> 6) |= Q_UINT64_C(1) << (id & 63);
+}
+
+void TagSet::remove(int id)
+{
+  if(id < 0 || (id >> 6) >= words())
+    return;
+  wordRef(id >> 6) &= ~(Q_UINT64_C(1) << (id & 63));
+}
+
+void TagSet::clear()
+{
+  first = 0;
+  rest.clear();
+}
+
+bool TagSet::isEmpty() const
+{
+  for(int i = 0; i < words(); i++)
+    if(word(i))
+      return false;
+  return true;
+}
+
+int TagSet::count() const
+{
+  int nb = 0;
+  for(int i = 0; i < words(); i++)
+    nb += qPopulationCount(word(i));
+  return nb;
+}
+
+QList<int> TagSet::ids() const
+{
+  QList<int> rv;
+  for(int i = 0; i < words(); i++) {
+    quint64 w = word(i);
+    while(w) {
+      rv << (i << 6) + qCountTrailingZeroBits(w);
+      w &= w - 1;
+    }
+  }
+  return rv;
+}
+
+TagSet & TagSet::operator|=(const TagSet & other)
+{
+  for(int i = other.words() - 1; i >= 0; i--) {
+    quint64 w = other.word(i);
+    if(w)
+      wordRef(i) |= w;
+  }
+  return *this;
+}
+
+TagSet & TagSet::operator&=(const TagSet & other)
+{
+  for(int i = 0; i < words(); i++)
+    wordRef(i) &= other.word(i);
+  return *this;
+}
+
+TagSet & TagSet::subtract(const TagSet & other)
+{
+  for(int i = 0; i < words(); i++)
+    wordRef(i) &= ~other.word(i);
+  return *this;
+}
+
+bool TagSet::intersects(const TagSet & other) const
+{
+  int nb = std::min(words(), other.words());
+  for(int i = 0; i < nb; i++)
+    if(word(i) & other.word(i))
+      return true;
+  return false;
+}
+
+bool TagSet::containsAll(const TagSet & other) const
+{
+  for(int i = 0; i < other.words(); i++) {
+    quint64 w = other.word(i);
+    if((word(i) & w) != w)
+      return false;
+  }
+  return true;
+}
+
+bool TagSet::operator==(const TagSet & other) const
+{
+  int nb = std::max(words(), other.words());
+  for(int i = 0; i < nb; i++)
+    if(word(i) != other.word(i))
+      return false;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+QList<Tag *> TagList::tags() const
+{
+  QList<Tag *> rv;
+  if(! hash)
+    return rv;
+  for(int id : bits.ids()) {
+    Tag * t = hash->tagForID(id);
+    if(t)
+      rv << t;
+  }
+  return rv;
+}
+
 QString TagList::toString() const
 {
   QStringList l;
-  for(QList<Tag*>::const_iterator i = constData().begin(); 
-      i != constData().end(); i++) 
-    l << (*i)->name;
+  for(const Tag * t : tags())
+    l << t->name;
   return l.join(", ");
 }
 
 void TagList::fromString(const QString & str, Wallet * wallet)
 {
-  clear();			// Done with the contents
-  QTextStream o(stdout);
+  bits.clear();			// Done with the contents
+  hash = &wallet->tags;
   QStringList l = str.split(QRegExp("\\s*,\\s*"), QString::SkipEmptyParts);
   for(QStringList::iterator i = l.begin(); i != l.end(); i++) {
-    append(wallet->tags.namedTag(*i, true)); // Create if necessary
+    Tag * t = wallet->tags.namedTag(*i, true); // Create if necessary
+    bits.insert(t->id);
   }
+  attributeChanged("members");
 }
 
 
 void TagList::setTag(Tag * t)
 {
-  if(constData().contains(t))
+  if(! t || hasTag(t))
     return;
-  append(t);
+  if(t->owner)
+    hash = t->owner;
+  bits.insert(t->id);
+  attributeChanged("members");
 }
 
 void TagList::clearTag(Tag * t)
 {
-  int i = constData().indexOf(t);
-  if(i >= 0)
-    removeAt(i);
+  if(! hasTag(t))
+    return;
+  bits.remove(t->id);
+  attributeChanged("members");
 }
 
-bool TagList::hasTag(Tag * t) const
+bool TagList::hasTag(const Tag * t) const
 {
-  return constData().contains(t);
+  return t && bits.contains(t->id);
 }
 
+void TagList::clear()
+{
+  if(bits.isEmpty())
+    return;
+  bits.clear();
+  attributeChanged("members");
+}
+
+//////////////////////////////////////////////////////////////////////
 
 Tag * TagHash::namedTag(const QString &name, bool create)
 {
   iterator i = find(name);
   if(i != end()) {
+    ensureID(&i.value());
     return &(i.value());
   }
   if(create) {
     Tag * t = &(*this)[name];
     t->name = name;
+    ensureID(t);
     return t;
   }
   return NULL;
 }
 
+void TagHash::ensureID(Tag * t)
+{
+  if(t->id >= 0)
+    return;
+  t->owner = this;
+  // The Tag may have been recreated by loading, in which case it gets
+  // its former ID back.
+  t->id = ids.value(t->name, -1);
+  if(t->id < 0) {
+    t->id = namesByID.size();
+    namesByID << t->name;
+    ids[t->name] = t->id;
+  }
+}
+
+void TagHash::ensureIDs()
+{
+  for(iterator i = begin(); i != end(); ++i)
+    ensureID(&i.value());
+}
+
+TagSet TagHash::tagSet(const QList<const Tag *> & tags)
+{
+  TagSet rv;
+  for(const Tag * t : tags) {
+    ensureID(const_cast<Tag *>(t));
+    rv.insert(t->id);
+  }
+  return rv;
+}
+
 
 SerializationAccessor * Tag::serializationAccessor()
 {
@@ -27,9 +27,104 @@
 class Tag;
 class Wallet;
 
-/// A list of pointer to Tag objects.
-class TagList : public WatchablePtrList<Tag> {
+/// A compact set of Tag objects, stored as a bitset indexed by
+/// Tag::id. The bits of the first 64 tags are stored inline, the
+/// following ones spill over to the heap.
+///
+/// All the set operations work a full word at a time.
+class TagSet {
+  /// The bits for the ids 0 to 63
+  quint64 first;
+
+  /// The bits for the ids 64 and above, 64 by word.
+  QVector<quint64> rest;
+
+  /// The word number @a i, with 0 being first.
+  quint64 word(int i) const {
+    if(i == 0)
+      return first;
+    return (i <= rest.size() ? rest[i-1] : 0);
+  };
+
+  /// The number of words.
+  int words() const {
+    return rest.size() + 1;
+  };
+
+  /// Returns a reference to the word @a i, growing the storage if
+  /// necessary.
+  quint64 & wordRef(int i);
+
 public:
+  TagSet() : first(0) {;};
+
+  /// Whether the given id is in the set.
+  bool contains(int id) const {
+    if(id < 0)
+      return false;
+    return word(id >> 6) & (Q_UINT64_C(1) << (id & 63));
+  };
+
+  /// Adds the given id.
+  void insert(int id);
+
+  /// Removes the given id.
+  void remove(int id);
+
+  /// Removes everything.
+  void clear();
+
+  /// Whether the set is empty.
+  bool isEmpty() const;
+
+  /// The number of elements.
+  int count() const;
+
+  /// Returns the ids of the set, in increasing order.
+  QList<int> ids() const;
+
+  /// Union
+  TagSet & operator|=(const TagSet & other);
+
+  /// Intersection
+  TagSet & operator&=(const TagSet & other);
+
+  /// Removes all the elements of @a other.
+  TagSet & subtract(const TagSet & other);
+
+  /// Whether the two sets have elements in common.
+  bool intersects(const TagSet & other) const;
+
+  /// Whether all the elements of @a other are in this set.
+  bool containsAll(const TagSet & other) const;
+
+  /// Whether the set contains all of @a required and none of
+  /// @a excluded.
+  bool matches(const TagSet & required, const TagSet & excluded) const {
+    return containsAll(required) && ! intersects(excluded);
+  };
+
+  bool operator==(const TagSet & other) const;
+  bool operator!=(const TagSet & other) const {
+    return ! (*this == other);
+  };
+};
+
+class TagHash;
+
+/// The list of tags of a Categorizable object. It is stored as a
+/// TagSet, so that the tags come in the order of their Tag::id.
+class TagList : public Watchable {
+  /// The tags
+  TagSet bits;
+
+  /// The hash the tags belong to, used to go from the ids back to
+  /// Tag objects. NULL as long as no tag was ever set.
+  const TagHash * hash;
+
+public:
+  TagList() : hash(NULL) {;};
+
   /// Converts the tag list into a comma-separated list.
   QString toString() const;
 
@@ -45,11 +140,37 @@ public:
   void clearTag(Tag * tag);
 
   /// Whether the given tag is in or not.
-  bool hasTag(Tag * tag) const;
+  bool hasTag(const Tag * tag) const;
+
+  /// Returns the underlying TagSet
+  const TagSet & tagSet() const {
+    return bits;
+  };
+
+  /// Returns the tags.
+  QList<Tag *> tags() const;
+
+  /// The number of tags
+  int size() const {
+    return bits.count();
+  };
+
+  /// Removes all the tags
+  void clear();
 };
 
 /// A hash of Tag, intended for storage.
+///
+/// It also gives dense ids to the tags (see Tag::id).
 class TagHash : public QHash<QString, Tag> {
+
+  /// The names of the tags, indexed by their Tag::id.
+  QVector<QString> namesByID;
+
+  /// Name -> Tag::id. The IDs are kept by name, so that a Tag
+  /// recreated by loading gets its former ID back.
+  QHash<QString, int> ids;
+
 public:
   /// Returns a pointer to the named (sub) category, or NULL if it
   /// does not exist.
@@ -67,6 +188,25 @@ public:
   QStringList tagNames() const {
     return keys();
   }; 
+
+  /// Makes sure the given tag, which must belong to the hash, has an
+  /// ID.
+  void ensureID(Tag * tag);
+
+  /// Makes sure all the tags have an ID. Should be called after
+  /// loading.
+  void ensureIDs();
+
+  /// Returns the Tag whose Tag::id is @a id, or NULL.
+  Tag * tagForID(int id) const {
+    if(id < 0 || id >= namesByID.size())
+      return NULL;
+    const_iterator it = constFind(namesByID[id]);
+    return it == constEnd() ? NULL : const_cast<Tag *>(&it.value());
+  };
+
+  /// Returns the TagSet containing the given tags.
+  TagSet tagSet(const QList<const Tag *> & tags);
 };
 
 /// This class represents a Tag, (or a label). It is an attribute that
@@ -82,7 +222,14 @@ public:
   /// The name of this tag
   QString name;
 
-  Tag() {;};
+  /// A small integer identifying the tag within its TagHash, used for
+  /// TagSet. -1 until it is assigned by TagHash::ensureID().
+  int id;
+
+  /// The TagHash the Tag belongs to, set by TagHash::ensureID()
+  TagHash * owner;
+
+  Tag() : id(-1), owner(NULL) {;};
 
 
   virtual SerializationAccessor * serializationAccessor();
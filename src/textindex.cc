@@ -0,0 +1,560 @@
+/*
+    textindex.cc: full-text search over the transactions and the documents
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <textindex.hh>
+
+#include <wallet.hh>
+#include <cabinet.hh>
+#include <documentlist.hh>
+#include <document.hh>
+#include <transactioncursor.hh>
+#include <pdftools.hh>
+
+QString TextIndex::fold(const QString & text)
+{
+  QString decomposed = text.normalized(QString::NormalizationForm_KD);
+  QString rv;
+  rv.reserve(decomposed.size());
+  for(QChar c : decomposed) {
+    switch(c.category()) {
+    case QChar::Mark_NonSpacing:
+    case QChar::Mark_SpacingCombining:
+    case QChar::Mark_Enclosing:
+      break;                    // the accents
+    default:
+      switch(c.unicode()) {
+      case 0x0152:              // OE
+      case 0x0153:
+        rv += "oe";
+        break;
+      case 0x00C6:              // AE
+      case 0x00E6:
+        rv += "ae";
+        break;
+      case 0x00DF:              // sharp s
+        rv += "ss";
+        break;
+      default:
+        rv += c.toLower();
+      }
+    }
+  }
+  return rv;
+}
+
+QStringList TextIndex::tokenize(const QString & text)
+{
+  QStringList rv;
+  QString folded = fold(text);
+  int start = -1;
+  for(int i = 0; i <= folded.size(); i++) {
+    bool word = i < folded.size() && folded[i].isLetterOrNumber();
+    if(word && start < 0)
+      start = i;
+    else if(! word && start >= 0) {
+      rv << folded.mid(start, i - start);
+      start = -1;
+    }
+  }
+  return rv;
+}
+
+int TextIndex::termID(const QString & word)
+{
+  QMap<QString, int>::const_iterator it = terms.constFind(word);
+  if(it != terms.constEnd())
+    return it.value();
+  int id = termNames.size();
+  terms[word] = id;
+  termNames << word;
+  postings.resize(id + 1);
+  return id;
+}
+
+void TextIndex::setItem(int item, const QStringList & fields)
+{
+  removeItem(item);
+  if(items.size() <= item)
+    items.resize(item + 1);
+
+  QVector<int> & seq = items[item];
+  for(const QString & f : fields) {
+    if(! seq.isEmpty())
+      seq << -1;
+    for(const QString & w : tokenize(f))
+      seq << termID(w);
+  }
+
+  QVector<int> ids = seq;
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  for(int id : ids) {
+    if(id < 0)
+      continue;
+    QVector<int> & p = postings[id];
+    p.insert(std::lower_bound(p.begin(), p.end(), item), item);
+  }
+}
+
+void TextIndex::removeItem(int item)
+{
+  if(item >= items.size())
+    return;
+  QVector<int> & seq = items[item];
+  for(int id : seq) {
+    if(id < 0)
+      continue;
+    QVector<int> & p = postings[id];
+    auto it = std::lower_bound(p.begin(), p.end(), item);
+    if(it != p.end() && *it == item)
+      p.erase(it);
+  }
+  seq.clear();
+}
+
+void TextIndex::clear()
+{
+  terms.clear();
+  termNames.clear();
+  postings.clear();
+  items.clear();
+}
+
+void TextIndex::rebuildPostings()
+{
+  terms.clear();
+  postings.clear();
+  postings.resize(termNames.size());
+  for(int i = 0; i < termNames.size(); i++)
+    terms[termNames[i]] = i;
+  // Going through the items in order keeps the postings sorted.
+  for(int i = 0; i < items.size(); i++) {
+    for(int id : items[i]) {
+      if(id < 0)
+        continue;
+      QVector<int> & p = postings[id];
+      if(p.isEmpty() || p.last() != i)
+        p << i;
+    }
+  }
+}
+
+QVector<int> TextIndex::termItems(const QString & word, bool prefix) const
+{
+  if(! prefix) {
+    int id = terms.value(word, -1);
+    return id < 0 ? QVector<int>() : postings[id];
+  }
+
+  QVector<int> rv;
+  for(QMap<QString, int>::const_iterator it = terms.lowerBound(word);
+      it != terms.constEnd() && it.key().startsWith(word); ++it) {
+    const QVector<int> & p = postings[it.value()];
+    QVector<int> merged;
+    merged.reserve(rv.size() + p.size());
+    std::set_union(rv.begin(), rv.end(), p.begin(), p.end(),
+                   std::back_inserter(merged));
+    rv.swap(merged);
+  }
+  return rv;
+}
+
+bool TextIndex::containsPhrase(int item, const QStringList & words,
+                               bool prefix) const
+{
+  const QVector<int> & seq = items[item];
+  int nb = words.size();
+  for(int i = 0; i + nb <= seq.size(); i++) {
+    int j = 0;
+    for(; j < nb; j++) {
+      int id = seq[i + j];
+      if(id < 0)
+        break;
+      const QString & w = termNames[id];
+      if(prefix && j == nb - 1 ? ! w.startsWith(words[j]) : w != words[j])
+        break;
+    }
+    if(j == nb)
+      return true;
+  }
+  return false;
+}
+
+QVector<int> TextIndex::search(const QString & query) const
+{
+  QVector<int> rv;
+  bool first = true;
+  int i = 0;
+  while(i < query.size()) {
+    if(query[i].isSpace()) {
+      ++i;
+      continue;
+    }
+
+    // Reads the next clause
+    QString clause;
+    bool phrase = query[i] == '"';
+    if(phrase) {
+      int end = query.indexOf('"', i + 1);
+      if(end < 0)
+        end = query.size();
+      clause = query.mid(i + 1, end - i - 1).trimmed();
+      i = end + 1;
+    }
+    else {
+      int end = i;
+      while(end < query.size() && ! query[end].isSpace())
+        ++end;
+      clause = query.mid(i, end - i);
+      i = end;
+    }
+    bool prefix = clause.endsWith('*');
+    QStringList words = tokenize(clause);
+    if(words.isEmpty())
+      continue;
+
+    // Words split by punctuation, such as l'eau, are taken as a
+    // phrase too.
+    QVector<int> matching;
+    for(int j = 0; j < words.size(); j++) {
+      QVector<int> its = termItems(words[j], prefix && j == words.size() - 1);
+      if(j == 0)
+        matching.swap(its);
+      else {
+        QVector<int> common;
+        std::set_intersection(matching.begin(), matching.end(),
+                              its.begin(), its.end(),
+                              std::back_inserter(common));
+        matching.swap(common);
+      }
+    }
+    if(words.size() > 1) {
+      QVector<int> found;
+      for(int it : matching)
+        if(containsPhrase(it, words, prefix))
+          found << it;
+      matching.swap(found);
+    }
+
+    if(first) {
+      rv.swap(matching);
+      first = false;
+    }
+    else {
+      QVector<int> common;
+      std::set_intersection(rv.begin(), rv.end(),
+                            matching.begin(), matching.end(),
+                            std::back_inserter(common));
+      rv.swap(common);
+    }
+    if(rv.isEmpty())
+      break;
+  }
+  return rv;
+}
+
+QDataStream & operator<<(QDataStream & out, const TextIndex & idx)
+{
+  return out << idx.termNames << idx.items;
+}
+
+QDataStream & operator>>(QDataStream & in, TextIndex & idx)
+{
+  in >> idx.termNames >> idx.items;
+  idx.rebuildPostings();
+  return in;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+TransactionTextIndex::TransactionTextIndex(Wallet * w) :
+  wallet(w), valid(false)
+{
+}
+
+QStringList TransactionTextIndex::fields(const AtomicTransaction * t)
+{
+  QStringList rv;
+  rv << t->getName() << t->getMemo() << t->getComment();
+  return rv;
+}
+
+void TransactionTextIndex::rebuild()
+{
+  index.clear();
+  transactions.clear();
+  numbers.clear();
+  for(AtomicTransaction * t : WalletCursor(wallet)) {
+    numbers[t] = transactions.size();
+    index.setItem(transactions.size(), fields(t));
+    transactions << t;
+  }
+  valid = true;
+}
+
+void TransactionTextIndex::invalidate()
+{
+  valid = false;
+  index.clear();
+  transactions.clear();
+  numbers.clear();
+}
+
+void TransactionTextIndex::transactionChanged(AtomicTransaction * t)
+{
+  if(! valid)
+    return;
+  int nb = numbers.value(t, -1);
+  if(nb < 0)
+    invalidate();
+  else
+    index.setItem(nb, fields(t));
+}
+
+TransactionVector TransactionTextIndex::search(const QString & query)
+{
+  if(! valid)
+    rebuild();
+  TransactionVector rv;
+  for(int i : index.search(query))
+    rv << transactions[i];
+  return rv;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/// Bumped whenever the format of the stored index, or the way the
+/// documents are indexed, changes.
+static const quint32 indexFormat = 1;
+
+QDataStream & operator<<(QDataStream & out,
+                         const DocumentTextIndex::Stamp & s)
+{
+  return out << s.item << s.size << s.modified << s.attributes;
+}
+
+QDataStream & operator>>(QDataStream & in, DocumentTextIndex::Stamp & s)
+{
+  return in >> s.item >> s.size >> s.modified >> s.attributes;
+}
+
+DocumentTextIndex::DocumentTextIndex(DocumentList * d) :
+  documents(d), loaded(false), scanNeeded(true)
+{
+}
+
+void DocumentTextIndex::load()
+{
+  Cabinet * cabinet = Cabinet::globalCabinet();
+  QString path = cabinet ? cabinet->fullFilePath() : QString();
+  QString target;
+  if(! path.isEmpty()) {
+    QByteArray hash = QCryptographicHash::hash(path.toUtf8(),
+                                               QCryptographicHash::Sha1);
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+             + "/text-index");
+    dir.mkpath(".");
+    target = dir.absoluteFilePath(QString::fromLatin1(hash.toHex()));
+  }
+  if(loaded && target == storage)
+    return;
+
+  loaded = true;
+  scanNeeded = true;
+  changed.clear();
+  storage = target;
+  index.clear();
+  stamps.clear();
+  files.clear();
+  freeItems.clear();
+  if(storage.isEmpty())
+    return;
+
+  QFile f(storage);
+  if(! f.open(QIODevice::ReadOnly))
+    return;
+  QDataStream in(&f);
+  quint32 format;
+  in >> format;
+  if(format != indexFormat)
+    return;
+  in >> stamps >> files >> freeItems >> index;
+  if(in.status() != QDataStream::Ok) {
+    index.clear();
+    stamps.clear();
+    files.clear();
+    freeItems.clear();
+  }
+}
+
+void DocumentTextIndex::save()
+{
+  if(storage.isEmpty())
+    return;
+  QSaveFile f(storage);
+  if(! f.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&f);
+  out << indexFormat << stamps << files << freeItems << index;
+  f.commit();
+}
+
+DocumentTextIndex::Stamp DocumentTextIndex::stampFor(const Document * doc)
+{
+  Stamp s;
+  s.item = -1;
+  QFileInfo info(doc->filePath());
+  s.size = info.size();
+  s.modified = info.lastModified().toMSecsSinceEpoch();
+  // The order of the elements of a QHash changes from a run to
+  // another, the hash must not depend on it.
+  QStringList keys = doc->attributes.keys();
+  keys.sort();
+  QStringList attrs;
+  for(const QString & k : keys)
+    attrs << k << doc->attributes.value(k).toString();
+  s.attributes = qHash(attrs.join(QChar(0)));
+  return s;
+}
+
+QStringList DocumentTextIndex::fields(const Document * doc)
+{
+  QStringList rv;
+  rv << doc->fileName();
+  if(doc->filePath().endsWith(".pdf", Qt::CaseInsensitive))
+    rv << PDFTools::readPDF(doc->filePath()).value("text").toString();
+  for(auto it = doc->attributes.constBegin();
+      it != doc->attributes.constEnd(); ++it)
+    if(it.value().type() == QVariant::String)
+      rv << it.value().toString();
+  return rv;
+}
+
+bool DocumentTextIndex::refresh(const Document * doc)
+{
+  QString file = doc->fileName();
+  Stamp s = stampFor(doc);
+  QHash<QString, Stamp>::iterator it = stamps.find(file);
+  if(it != stamps.end()) {
+    if(it->size == s.size && it->modified == s.modified &&
+       it->attributes == s.attributes)
+      return false;
+    s.item = it->item;
+  }
+  else {
+    if(freeItems.isEmpty()) {
+      s.item = files.size();
+      files << file;
+    }
+    else {
+      s.item = freeItems.takeLast();
+      files[s.item] = file;
+    }
+  }
+  index.setItem(s.item, fields(doc));
+  stamps[file] = s;
+  return true;
+}
+
+void DocumentTextIndex::forget(const QString & file)
+{
+  QHash<QString, Stamp>::iterator it = stamps.find(file);
+  if(it == stamps.end())
+    return;
+  int item = it->item;
+  stamps.erase(it);
+  index.removeItem(item);
+  files[item].clear();
+  freeItems << item;
+}
+
+void DocumentTextIndex::documentChanged(const Document * doc)
+{
+  changed.insert(doc->fileName());
+}
+
+void DocumentTextIndex::documentRemoved(const QString & file)
+{
+  changed.insert(file);
+}
+
+void DocumentTextIndex::rescan()
+{
+  scanNeeded = true;
+}
+
+int DocumentTextIndex::update()
+{
+  load();
+  int nb = 0;
+  int removed = 0;
+  if(scanNeeded) {
+    QSet<QString> present;
+    for(Document * doc : documents->allDocuments()) {
+      present.insert(doc->fileName());
+      if(refresh(doc))
+        ++nb;
+    }
+
+    QStringList gone;
+    for(auto it = stamps.constBegin(); it != stamps.constEnd(); ++it)
+      if(! present.contains(it.key()))
+        gone << it.key();
+    for(const QString & file : gone)
+      forget(file);
+    removed = gone.size();
+    scanNeeded = false;
+  }
+  else {
+    for(const QString & file : changed) {
+      const Document * doc = documents->document(file);
+      if(doc) {
+        if(refresh(doc))
+          ++nb;
+      }
+      else if(stamps.contains(file)) {
+        forget(file);
+        ++removed;
+      }
+    }
+  }
+  changed.clear();
+
+  if(nb > 0 || removed > 0)
+    save();
+  if(nb > 0)
+    PDFCache::globalCache()->flush();
+  return nb;
+}
+
+QList<Document *> DocumentTextIndex::search(const QString & query)
+{
+  update();
+  QStringList names;
+  for(int i : index.search(query))
+    names << files[i];
+  names.sort();
+  QList<Document *> rv;
+  for(const QString & n : names) {
+    Document * doc = documents->document(n);
+    if(doc)
+      rv << doc;
+  }
+  return rv;
+}
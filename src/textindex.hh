@@ -0,0 +1,240 @@
+/**
+    \file textindex.hh
+    Full-text search over the transactions and the documents
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __TEXTINDEX_HH
+#define __TEXTINDEX_HH
+
+class Wallet;
+class DocumentList;
+class Document;
+class AtomicTransaction;
+class TransactionVector;
+
+/// An inverted index from words to items, the items being numbered
+/// by their owner (see TransactionTextIndex and DocumentTextIndex).
+///
+/// Words are folded (see fold()), so that searches ignore case and
+/// accents. Each item is made of several fields; the sequence of
+/// words of each item is kept, which is what makes phrase queries
+/// possible.
+///
+/// The queries (see search()) are made of space-separated clauses,
+/// all of which must match:
+/// @li a word matches the items containing it;
+/// @li a word ending with a @b * matches the items containing a word
+/// starting with it;
+/// @li words between double quotes match the items containing them
+/// in this order, within the same field (the last one can end with a
+/// @b * too).
+class TextIndex {
+
+  /// Word -> word ID
+  QMap<QString, int> terms;
+
+  /// Word ID -> word
+  QVector<QString> termNames;
+
+  /// Word ID -> sorted item numbers
+  QVector<QVector<int> > postings;
+
+  /// Item number -> sequence of word IDs, with -1 between the fields
+  QVector<QVector<int> > items;
+
+  /// Returns the ID of the word, creating it if necessary.
+  int termID(const QString & word);
+
+  /// The items containing the given word, or a word starting with it
+  /// if @a prefix is true.
+  QVector<int> termItems(const QString & word, bool prefix) const;
+
+  /// Whether the item contains the given sequence of words.
+  bool containsPhrase(int item, const QStringList & words,
+                      bool prefix) const;
+
+  /// Fills the postings from the items.
+  void rebuildPostings();
+
+  friend QDataStream & operator<<(QDataStream & out, const TextIndex & idx);
+  friend QDataStream & operator>>(QDataStream & in, TextIndex & idx);
+
+public:
+
+  /// Returns the text in lower case, without accents and with the
+  /// usual ligatures expanded.
+  static QString fold(const QString & text);
+
+  /// Splits the text into folded words.
+  static QStringList tokenize(const QString & text);
+
+  /// Sets the fields of the given item, replacing the former ones.
+  void setItem(int item, const QStringList & fields);
+
+  /// Removes the item from the index.
+  void removeItem(int item);
+
+  /// Removes everything.
+  void clear();
+
+  /// The sorted numbers of the items matching the query.
+  QVector<int> search(const QString & query) const;
+};
+
+
+/// The full-text index of the name, memo and comment of all the
+/// transactions of a Wallet.
+///
+/// Like the CategorizationIndex, it is built lazily on the first
+/// query, and invalidated by Wallet::invalidateIndexes(). Only the
+/// comment can be edited in the interface, so it is the only field
+/// indexed again immediately (see transactionChanged()). The name and
+/// the memo come from the bank and only change on import, which
+/// invalidates the whole index.
+///
+/// Unlike DocumentTextIndex, this index is kept in memory only and
+/// rebuilt on the first query after loading. The texts are short, so
+/// the rebuild is a single pass over the transactions.
+class TransactionTextIndex {
+  Wallet * wallet;
+
+  bool valid;
+
+  TextIndex index;
+
+  /// Item number -> transaction, in chronological order
+  QVector<AtomicTransaction *> transactions;
+
+  /// Transaction -> item number
+  QHash<AtomicTransaction *, int> numbers;
+
+  /// The indexed texts of the transaction
+  static QStringList fields(const AtomicTransaction * transaction);
+
+  void rebuild();
+
+public:
+  explicit TransactionTextIndex(Wallet * wallet);
+
+  /// Marks the whole index as stale.
+  void invalidate();
+
+  /// Indexes again the texts of the transaction. No-op when the
+  /// index is not built yet.
+  void transactionChanged(AtomicTransaction * transaction);
+
+  /// The transactions matching the query (see TextIndex), sorted by
+  /// date.
+  TransactionVector search(const QString & query);
+};
+
+
+/// The full-text index of the documents of a DocumentList: their
+/// file name, their text (as returned by PDFTools::readPDF()) and
+/// the string values of their attributes.
+///
+/// The index is stored on disk, in the cache location, alongside the
+/// size and modification time of the files and a hash of their
+/// attributes. The first update() after loading compares them for
+/// all the documents, since the files may have changed in between.
+/// Afterwards, update() only looks at the documents signalled
+/// through documentChanged() and documentRemoved(), which the
+/// DocumentList and the editors call on import, renaming and
+/// edition; it is called before each query.
+class DocumentTextIndex {
+
+  /// What is used to detect changes in a document
+  class Stamp {
+  public:
+    int item;
+    qint64 size;
+    qint64 modified;
+    uint attributes;
+  };
+
+  friend QDataStream & operator<<(QDataStream & out, const Stamp & s);
+  friend QDataStream & operator>>(QDataStream & in, Stamp & s);
+
+  DocumentList * documents;
+
+  TextIndex index;
+
+  /// File name -> stamp
+  QHash<QString, Stamp> stamps;
+
+  /// The file names of the items
+  QVector<QString> files;
+
+  /// The numbers of the removed items
+  QVector<int> freeItems;
+
+  /// The file the index was read from (and is saved to)
+  QString storage;
+
+  /// Whether load() was called already
+  bool loaded;
+
+  /// Whether the next update() must check all the documents
+  bool scanNeeded;
+
+  /// The file names of the documents to check at the next update()
+  QSet<QString> changed;
+
+  /// Reads the index from the storage for the current Cabinet, if
+  /// that hasn't been done yet.
+  void load();
+
+  void save();
+
+  /// The stamp of the document, without the item number
+  static Stamp stampFor(const Document * doc);
+
+  /// The indexed texts of the document.
+  static QStringList fields(const Document * doc);
+
+  /// Indexes the document again if its stamp changed. Returns true
+  /// if it was indexed.
+  bool refresh(const Document * doc);
+
+  /// Removes the file from the index, if it is there.
+  void forget(const QString & file);
+
+public:
+  explicit DocumentTextIndex(DocumentList * documents);
+
+  /// Indexes the new and modified documents, and forgets about the
+  /// removed ones. Returns the number of documents indexed.
+  int update();
+
+  /// Signals that the document was added or edited.
+  void documentChanged(const Document * doc);
+
+  /// Signals that the named file is no longer a document, for
+  /// instance after a renaming.
+  void documentRemoved(const QString & file);
+
+  /// Makes the next update() check all the documents, for instance
+  /// after files were modified on disk.
+  void rescan();
+
+  /// The documents matching the query (see TextIndex), sorted by file
+  /// name.
+  QList<Document *> search(const QString & query);
+};
+
+#endif
@@ -66,7 +66,7 @@ void TimeBasedCurve::ensureSorted()
     return;
   qSort(data);
   // We cache min and max
-  min = max = data.first().amount();
+  min = max = data.isEmpty() ? 0 : data.first().amount();
 
   for(int i = 1; i < data.size(); i++) {
     int a = data[i].amount();
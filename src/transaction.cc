@@ -20,6 +20,7 @@
 #include <transaction.hh>
 #include <account.hh>
 #include <wallet.hh>
+#include <budget.hh>
 
 void Transaction::dump(QIODevice * dev)
 {
@@ -131,8 +132,9 @@ bool Transaction::compareCheckNumbers(AtomicTransaction * a,
 
 QString Transaction::transactionID() const
 {
-  return toHash().
-    formatString("%{date%date:dd/MM/yy}##%{amount%A}##%{memo}##%{name}");
+  static const AttributeHash::FormatTemplate
+    idFormat("%{date%date:dd/MM/yy}##%{amount%A}##%{memo}##%{name}");
+  return idFormat.render(toHash());
 }
 
 Account * Transaction::getAccount() const
@@ -149,11 +151,42 @@ QList<AtomicTransaction*> Transaction::allSubTransactions()
   return ret;
 }
 
+void Transaction::setDate(const QDate & d)
+{
+  if(date == d)
+    return;
+  setAttribute(date, d, "date");
+  if(account)
+    account->invalidateDateIndex();
+  if(account && account->wallet) {
+    for(AtomicTransaction * t : *this)
+      account->wallet->aggregates.transactionChanged(t);
+  }
+}
+
+AtomicTransaction * Transaction::addSubTransaction(int amount)
+{
+  subTransactions.append(AtomicTransaction(amount, this));
+  // The amount is taken from this transaction
+  notifyRealizations(-amount);
+  if(account && account->wallet)
+    account->wallet->invalidateIndexes();
+  return &subTransactions.last();
+}
+
 void Transaction::removeSubTransaction(AtomicTransaction * subTransaction)
 {
   for(int i = 0; i < subTransactions.size(); i++) {
     if(subTransaction == &(subTransactions[i])) {
+      // The amount goes back to this transaction, and the
+      // sub-transaction leaves its realization, if any.
+      notifyRealizations(subTransaction->getAmount());
+      for(BudgetRealization * r : subTransaction->links.
+            typedLinks<BudgetRealization>("budget-realization"))
+        subTransaction->removeLink(r, "budget-realization");
       subTransactions.removeAt(i);
+      if(account && account->wallet)
+        account->wallet->invalidateIndexes();
       break;
     }
   }
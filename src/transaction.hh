@@ -173,9 +173,8 @@ public:
     return date;
   };
 
-  void setDate(const QDate & d) {
-    setAttribute(date, d, "date");
-  };
+  /// Sets the date, of this transaction and of its sub-transactions.
+  void setDate(const QDate & d);
 
   /// Returns the name of the transaction.
   virtual QString getName() const {
@@ -251,6 +250,9 @@ public:
   /// transactions.
   QList<AtomicTransaction*> allSubTransactions();
 
+  /// Adds a sub transaction with the given amount, and returns it.
+  AtomicTransaction * addSubTransaction(int amount = 0);
+
   /// Remove the given subtransaction.
   ///
   /// Cannot be used to remove the "main" subtransaction, ie the one
@@ -0,0 +1,156 @@
+/*
+    transactioncursor.cc: traversal of the transactions of accounts and wallets
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <headers.hh>
+#include <transactioncursor.hh>
+#include <wallet.hh>
+
+#include <limits>
+
+AccountCursor::AccountCursor() :
+  list(NULL), transaction(0), stop(0), sub(-1)
+{
+}
+
+AccountCursor::AccountCursor(const Account * account,
+                             const TransactionPredicate & p) :
+  list(&account->transactions), transaction(0),
+  stop(account->transactions.size()), sub(-1), predicate(p)
+{
+  skipRejected();
+}
+
+AccountCursor::AccountCursor(const Account * account, int first, int last,
+                             const TransactionPredicate & p) :
+  list(&account->transactions), transaction(first),
+  stop(std::min(last, account->transactions.size())), sub(-1), predicate(p)
+{
+  skipRejected();
+}
+
+AccountCursor::AccountCursor(const TransactionList * lst,
+                             const TransactionPredicate & p) :
+  list(lst), transaction(0), stop(lst->size()), sub(-1), predicate(p)
+{
+  skipRejected();
+}
+
+void AccountCursor::step()
+{
+  ++sub;
+  if(sub >= list->at(transaction).subTransactions.size()) {
+    sub = -1;
+    ++transaction;
+  }
+}
+
+void AccountCursor::skipRejected()
+{
+  if(! predicate)
+    return;
+  while(! atEnd() && ! predicate(current()))
+    step();
+}
+
+TransactionPtrList AccountCursor::toPtrList()
+{
+  TransactionPtrList ret;
+  for(; ! atEnd(); next())
+    ret << current();
+  return ret;
+}
+
+TransactionVector AccountCursor::toVector()
+{
+  TransactionVector ret;
+  for(; ! atEnd(); next())
+    ret << current();
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+WalletCursor::WalletCursor(const Wallet * wallet,
+                           const TransactionPredicate & predicate) :
+  currentCursor(-1)
+{
+  for(int i = 0; i < wallet->accounts.size(); i++) {
+    cursors.append(AccountCursor(&wallet->accounts.at(i), predicate));
+    heads.append(0);
+    updateHead(i);
+  }
+  pickCurrent();
+}
+
+WalletCursor::WalletCursor(const QList<Account *> & accounts,
+                           const TransactionPredicate & predicate) :
+  currentCursor(-1)
+{
+  for(int i = 0; i < accounts.size(); i++) {
+    cursors.append(AccountCursor(accounts[i], predicate));
+    heads.append(0);
+    updateHead(i);
+  }
+  pickCurrent();
+}
+
+void WalletCursor::updateHead(int idx)
+{
+  const AccountCursor & c = cursors[idx];
+  if(c.atEnd())
+    heads[idx] = std::numeric_limits<qint64>::max();
+  else
+    heads[idx] = c.currentDate().toJulianDay();
+}
+
+void WalletCursor::pickCurrent()
+{
+  // There are only a few accounts, a linear search is faster than
+  // maintaining a heap.
+  currentCursor = -1;
+  qint64 best = std::numeric_limits<qint64>::max();
+  for(int i = 0; i < heads.size(); i++) {
+    if(heads[i] < best) {
+      best = heads[i];
+      currentCursor = i;
+    }
+  }
+}
+
+void WalletCursor::next()
+{
+  cursors[currentCursor].next();
+  updateHead(currentCursor);
+  pickCurrent();
+}
+
+TransactionPtrList WalletCursor::toPtrList()
+{
+  TransactionPtrList ret;
+  for(; ! atEnd(); next())
+    ret << current();
+  return ret;
+}
+
+TransactionVector WalletCursor::toVector()
+{
+  TransactionVector ret;
+  for(; ! atEnd(); next())
+    ret << current();
+  return ret;
+}
@@ -0,0 +1,231 @@
+/**
+    \file transactioncursor.hh
+    Allocation-free traversal of the transactions of accounts and wallets
+    Copyright 2020 by Vincent Fourmond
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __TRANSACTIONCURSOR_HH
+#define __TRANSACTIONCURSOR_HH
+
+#include <transactionlists.hh>
+
+class Account;
+class Wallet;
+
+/// A predicate used to filter the transactions returned by a cursor.
+typedef std::function<bool (const AtomicTransaction *)> TransactionPredicate;
+
+/// Single-pass iterator over one of the cursor classes below, so that
+/// they can be used in range-based for loops:
+///
+/// \code
+/// for(AtomicTransaction * t : WalletCursor(wallet))
+///   ...
+/// \endcode
+///
+/// Advancing the iterator advances the underlying cursor.
+template <class C> class CursorIterator {
+  /// The cursor, or NULL for the end iterator
+  C * cursor;
+public:
+  explicit CursorIterator(C * c = NULL) :
+    cursor((c && ! c->atEnd()) ? c : NULL) {
+  };
+
+  AtomicTransaction * operator*() const {
+    return cursor->current();
+  };
+
+  CursorIterator & operator++() {
+    cursor->next();
+    if(cursor->atEnd())
+      cursor = NULL;
+    return *this;
+  };
+
+  bool operator==(const CursorIterator & o) const {
+    return cursor == o.cursor;
+  };
+
+  bool operator!=(const CursorIterator & o) const {
+    return cursor != o.cursor;
+  };
+};
+
+/// Walks through all the AtomicTransaction objects of a
+/// TransactionList, ie each Transaction followed by its
+/// sub-transactions, in the order of the list (which is chronological
+/// for the transactions of an Account).
+///
+/// Contrary to Account::allTransactions(), it does not build a
+/// TransactionPtrList, and hence neither allocates memory nor
+/// connects any signal. It does not emit signals either, as it only
+/// uses the const accessors of the lists.
+///
+/// The cursor must not be used after the list has been modified.
+class AccountCursor {
+  /// The list being walked through
+  const TransactionList * list;
+
+  /// The index of the current Transaction in the list
+  int transaction;
+
+  /// The index of the Transaction at which the cursor stops
+  int stop;
+
+  /// The index of the current sub-transaction, or -1 for the
+  /// Transaction itself.
+  int sub;
+
+  /// If not empty, only the transactions for which it is true are
+  /// returned.
+  TransactionPredicate predicate;
+
+  /// Moves to the next position, without looking at the predicate.
+  void step();
+
+  /// Skips all the transactions that don't match the predicate
+  void skipRejected();
+
+public:
+
+  /// An empty cursor
+  AccountCursor();
+
+  /// Walks through the transactions of the given account.
+  explicit AccountCursor(const Account * account,
+                         const TransactionPredicate & predicate =
+                         TransactionPredicate());
+
+  /// Walks through the transactions of the given account, from the
+  /// Transaction at index @a first (inclusive) to the one at @a last
+  /// (exclusive), see Account::transactionRange().
+  AccountCursor(const Account * account, int first, int last,
+                const TransactionPredicate & predicate =
+                TransactionPredicate());
+
+  /// Walks through the transactions of the given list.
+  explicit AccountCursor(const TransactionList * list,
+                         const TransactionPredicate & predicate =
+                         TransactionPredicate());
+
+  /// Whether there are no more transactions.
+  bool atEnd() const {
+    return (! list) || transaction >= stop;
+  };
+
+  /// The current transaction. Only valid if atEnd() is false.
+  AtomicTransaction * current() const {
+    const Transaction & t = list->at(transaction);
+    /// @todo const_cast, like in TransactionList::toPtrList()
+    if(sub < 0)
+      return const_cast<Transaction *>(&t);
+    return const_cast<AtomicTransaction *>(&t.subTransactions.at(sub));
+  };
+
+  /// The date of the current transaction.
+  QDate currentDate() const {
+    return list->at(transaction).getDate();
+  };
+
+  /// Moves to the next matching transaction.
+  void next() {
+    step();
+    skipRejected();
+  };
+
+  /// Collects the remaining transactions into a TransactionPtrList.
+  TransactionPtrList toPtrList();
+
+  /// Collects the remaining transactions into a TransactionVector.
+  TransactionVector toVector();
+
+  CursorIterator<AccountCursor> begin() {
+    return CursorIterator<AccountCursor>(this);
+  };
+
+  CursorIterator<AccountCursor> end() {
+    return CursorIterator<AccountCursor>();
+  };
+};
+
+/// Walks through all the AtomicTransaction objects of several
+/// accounts (by default, all the ones of a Wallet) in chronological
+/// order, merging the AccountCursor of each account. Transactions
+/// with the same date come in the order of the accounts.
+///
+/// Like AccountCursor, it does not allocate memory for usual numbers
+/// of accounts.
+class WalletCursor {
+  /// The cursors for each account
+  QVarLengthArray<AccountCursor, 8> cursors;
+
+  /// The julian day of the current transaction of each cursor, or
+  /// a very large number for the cursors at end.
+  QVarLengthArray<qint64, 8> heads;
+
+  /// The index of the cursor holding the current transaction, or -1
+  /// if all of them are at end.
+  int currentCursor;
+
+  /// Updates the value of heads for the given cursor
+  void updateHead(int idx);
+
+  /// Finds the cursor with the earliest transaction.
+  void pickCurrent();
+
+public:
+
+  /// Walks through all the transactions of the wallet.
+  explicit WalletCursor(const Wallet * wallet,
+                        const TransactionPredicate & predicate =
+                        TransactionPredicate());
+
+  /// Walks through all the transactions of the given accounts.
+  explicit WalletCursor(const QList<Account *> & accounts,
+                        const TransactionPredicate & predicate =
+                        TransactionPredicate());
+
+  bool atEnd() const {
+    return currentCursor < 0;
+  };
+
+  /// The current transaction. Only valid if atEnd() is false.
+  AtomicTransaction * current() const {
+    return cursors[currentCursor].current();
+  };
+
+  /// Moves to the next matching transaction in chronological order.
+  void next();
+
+  /// Collects the remaining transactions into a TransactionPtrList,
+  /// which is therefore sorted by date.
+  TransactionPtrList toPtrList();
+
+  /// Same as toPtrList(), but into a TransactionVector.
+  TransactionVector toVector();
+
+  CursorIterator<WalletCursor> begin() {
+    return CursorIterator<WalletCursor>(this);
+  };
+
+  CursorIterator<WalletCursor> end() {
+    return CursorIterator<WalletCursor>();
+  };
+};
+
+#endif
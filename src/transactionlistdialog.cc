@@ -19,6 +19,7 @@
 #include <headers.hh>
 #include <transactionlistdialog.hh>
 #include <wallet.hh>
+#include <transactioncursor.hh>
 
 TransactionListDialog::TransactionListDialog()
 {
@@ -75,20 +76,15 @@ void TransactionListDialog::displayTag(Tag * tag,
 void TransactionListDialog::displayTransactionsForPeriod(const QList<Account *>& accounts,
                                                          const Period & period)
 {
-  TransactionPtrList list;
-
   QStringList names;
-  for(int j = 0; j < accounts.size(); j++) {
-    Account * account = accounts[j];
-    names << account->name();
-    TransactionPtrList 	trs = account->allTransactions();
-    for(int i = 0; i < trs.size(); i++) {
-      AtomicTransaction * t = trs[i];
-      if(period.contains(t->getDate()))
-        list << t;
-    }
-  }
-  list.sortByDate();
+  for(int j = 0; j < accounts.size(); j++)
+    names << accounts[j]->name();
+
+  // Already sorted by date
+  TransactionPtrList list =
+    WalletCursor(accounts, [&period](const AtomicTransaction * t) {
+        return period.contains(t->getDate());
+      }).toPtrList();
 
   QString label= tr("%1 to %2").arg(period.startDate.toString("dd MMMM yyyy")).
     arg(period.endDate.toString("dd MMMM yyyy"));
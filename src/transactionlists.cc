@@ -24,6 +24,8 @@
 #include <logstream.hh>
 #include <pointersafesort.hh>
 #include <periodic.hh>
+#include <amountkernels.hh>
+#include <transactioncursor.hh>
 
 BasicStatistics::BasicStatistics() :
   number(0), numberCredit(0), numberDebit(0), 
@@ -34,21 +36,36 @@ BasicStatistics::BasicStatistics() :
 
 void BasicStatistics::addTransaction(const AtomicTransaction * t)
 {
-  number += 1;
-  totalAmount += t->getAmount();
+  addAmount(t->getAmount());
   if(t->getAccount() && (firstMonthID < 0 ||
 		    t->getAccount()->firstMonthID() < firstMonthID))
     firstMonthID = t->getAccount()->firstMonthID();
-  if(t->getAmount() < 0) {
-    totalDebit += t->getAmount();
-    numberDebit ++;
+}
+
+void BasicStatistics::addAmount(int amount, int weight)
+{
+  number += weight;
+  totalAmount += weight * amount;
+  if(amount < 0) {
+    totalDebit += weight * amount;
+    numberDebit += weight;
   }
   else {
-    totalCredit += t->getAmount();
-    numberCredit ++;
+    totalCredit += weight * amount;
+    numberCredit += weight;
   }
 }
 
+void BasicStatistics::addAmounts(const int * amounts, int n)
+{
+  AmountSums s = sumAmounts(amounts, n);
+  number += s.number;
+  numberCredit += s.numberCredit;
+  numberDebit += s.numberDebit;
+  totalCredit += s.totalCredit;
+  totalDebit += s.totalDebit;
+  totalAmount += s.total();
+}
 
 BasicStatistics & BasicStatistics::operator+=(const BasicStatistics & a)
 {
@@ -58,7 +75,10 @@ BasicStatistics & BasicStatistics::operator+=(const BasicStatistics & a)
   totalAmount += a.totalAmount;
   totalCredit += a.totalCredit;
   totalDebit += a.totalDebit;
-  firstMonthID = std::min(firstMonthID, a.firstMonthID);
+  // A negative firstMonthID means "unknown"
+  if(firstMonthID < 0 || (a.firstMonthID >= 0 &&
+                          a.firstMonthID < firstMonthID))
+    firstMonthID = a.firstMonthID;
   return *this;
 }
 
@@ -90,14 +110,229 @@ int TransactionListStatistics::monthlyAverageAmount()
   return 0;
 }
 
-TransactionListStatistics TransactionPtrList::statistics() const
+TransactionListStatistics & TransactionListStatistics::operator+=(const TransactionListStatistics & a)
+{
+  BasicStatistics::operator+=(a);
+  for(QHash<int, BasicStatistics>::const_iterator i = a.monthlyStats.constBegin();
+      i != a.monthlyStats.constEnd(); i++)
+    monthlyStats[i.key()] += i.value();
+  for(QHash<int, BasicStatistics>::const_iterator i = a.yearlyStats.constBegin();
+      i != a.yearlyStats.constEnd(); i++)
+    yearlyStats[i.key()] += i.value();
+  return *this;
+}
+
+/// The statistics of the elements from @a begin to @a end of any list
+/// of transaction pointers.
+template <class L>
+static TransactionListStatistics rangeStatistics(const L & lst,
+                                                 int begin, int end)
 {
   TransactionListStatistics stats;
-  for(int i = 0; i < size(); i++)
-    stats.addTransaction(value(i));
+
+  // Lists are most often sorted by date, so we gather the amounts of
+  // runs of transactions of the same month (and account), and account
+  // for each run at once.
+  QVector<int> amounts;
+  amounts.reserve(std::min(end - begin, 512));
+  int runMonth = -1;
+  int runYear = 0;
+  int runFirstMonth = -1;
+  auto flush = [&]() {
+    if(amounts.isEmpty())
+      return;
+    BasicStatistics s;
+    s.addAmounts(amounts.constData(), amounts.size());
+    s.firstMonthID = runFirstMonth;
+    stats += s;
+    stats.monthlyStats[runMonth] += s;
+    stats.yearlyStats[runYear] += s;
+    amounts.clear();
+  };
+
+  // The firstMonthID of the account only needs to be looked up when
+  // the account changes, which is seldom.
+  const Account * lastAccount = NULL;
+  int accountFirstMonth = -1;
+  for(int i = begin; i < end; i++) {
+    const AtomicTransaction * t = lst.at(i);
+    const Account * ac = t->getAccount();
+    if(ac != lastAccount) {
+      lastAccount = ac;
+      accountFirstMonth = ac ? ac->firstMonthID() : -1;
+    }
+    QDate date = t->getDate();
+    int month = AtomicTransaction::monthID(date);
+    if(month != runMonth || accountFirstMonth != runFirstMonth) {
+      flush();
+      runMonth = month;
+      runYear = date.year();
+      runFirstMonth = accountFirstMonth;
+    }
+    amounts << t->getAmount();
+  }
+  flush();
+  return stats;
+}
+
+/// The statistics of a whole list, split into chunks computed in
+/// parallel for large lists.
+template <class L>
+static TransactionListStatistics listStatistics(const L & lst)
+{
+  const int minChunk = TransactionPtrList::statisticsChunk;
+  int size = lst.size();
+  int chunks = std::min(QThread::idealThreadCount(), size/minChunk);
+  if(chunks <= 1)
+    return rangeStatistics(lst, 0, size);
+
+  QList<QFuture<TransactionListStatistics> > futures;
+  for(int i = 0; i < chunks; i++) {
+    int begin = (size * i)/chunks;
+    int end = (size * (i+1))/chunks;
+    futures << QtConcurrent::run([&lst, begin, end]() {
+        return rangeStatistics(lst, begin, end);
+      });
+  }
+  TransactionListStatistics stats;
+  for(int i = 0; i < futures.size(); i++)
+    stats += futures[i].result();
   return stats;
 }
 
+TransactionListStatistics TransactionPtrList::statistics(int begin, int end) const
+{
+  return rangeStatistics(*this, begin, end);
+}
+
+TransactionListStatistics TransactionPtrList::statistics() const
+{
+  return listStatistics(*this);
+}
+
+DailyStatistics TransactionPtrList::dailyStatistics() const
+{
+  return DailyStatistics(*this);
+}
+
+TransactionListStatistics TransactionVector::statistics() const
+{
+  return listStatistics(*this);
+}
+
+DailyStatistics TransactionVector::dailyStatistics() const
+{
+  return DailyStatistics(*this);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+template <class L> void DailyStatistics::build(const L & lst)
+{
+  QDate last;
+  for(int i = 0; i < lst.size(); i++) {
+    QDate d = lst[i]->getDate();
+    if(! d.isValid())
+      continue;
+    if(! firstDate.isValid() || d < firstDate)
+      firstDate = d;
+    if(! last.isValid() || d > last)
+      last = d;
+  }
+  if(! firstDate.isValid())
+    return;
+
+  int days = firstDate.daysTo(last) + 1;
+  prefixes.resize(days + 1);
+
+  // First the contributions of each day, shifted by one...
+  for(int i = 0; i < lst.size(); i++) {
+    QDate d = lst[i]->getDate();
+    if(! d.isValid())
+      continue;
+    Prefix & p = prefixes[firstDate.daysTo(d) + 1];
+    int amount = lst[i]->getAmount();
+    ++p.number;
+    if(amount < 0) {
+      ++p.numberDebit;
+      p.totalDebit += amount;
+    }
+    else {
+      ++p.numberCredit;
+      p.totalCredit += amount;
+    }
+  }
+
+  // ... and then the running sums
+  for(int i = 1; i <= days; i++) {
+    Prefix & p = prefixes[i];
+    const Prefix & b = prefixes[i-1];
+    p.number += b.number;
+    p.numberCredit += b.numberCredit;
+    p.numberDebit += b.numberDebit;
+    p.totalCredit += b.totalCredit;
+    p.totalDebit += b.totalDebit;
+  }
+}
+
+DailyStatistics::DailyStatistics(const TransactionPtrList & lst)
+{
+  build(lst);
+}
+
+DailyStatistics::DailyStatistics(const TransactionVector & lst)
+{
+  build(lst);
+}
+
+int DailyStatistics::dayIndex(const QDate & date) const
+{
+  qint64 idx = firstDate.daysTo(date);
+  if(idx < 0)
+    return 0;
+  if(idx >= prefixes.size())
+    return prefixes.size() - 1;
+  return idx;
+}
+
+BasicStatistics DailyStatistics::statistics(const QDate & from,
+                                            const QDate & to) const
+{
+  BasicStatistics ret;
+  if(prefixes.isEmpty() || to < from)
+    return ret;
+  const Prefix & a = prefixes[dayIndex(from)];
+  const Prefix & b = prefixes[dayIndex(to.addDays(1))];
+  ret.number = b.number - a.number;
+  ret.numberCredit = b.numberCredit - a.numberCredit;
+  ret.numberDebit = b.numberDebit - a.numberDebit;
+  ret.totalCredit = b.totalCredit - a.totalCredit;
+  ret.totalDebit = b.totalDebit - a.totalDebit;
+  ret.totalAmount = ret.totalCredit + ret.totalDebit;
+  return ret;
+}
+
+QVector<int> DailyStatistics::rollingAmounts(int days, const QDate & from,
+                                             const QDate & to) const
+{
+  QVector<int> ret;
+  if(to < from)
+    return ret;
+  ret.reserve(from.daysTo(to) + 1);
+  for(QDate d = from; d <= to; d = d.addDays(1)) {
+    if(prefixes.isEmpty()) {
+      ret << 0;
+      continue;
+    }
+    const Prefix & a = prefixes[dayIndex(d.addDays(1 - days))];
+    const Prefix & b = prefixes[dayIndex(d.addDays(1))];
+    ret << (b.totalCredit + b.totalDebit) - (a.totalCredit + a.totalDebit);
+  }
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 TransactionList TransactionList::sublist(const Account &ac) const
 {
   TransactionList retval;
@@ -174,14 +409,11 @@ void TransactionList::sanitizeList(Account * ac)
 
 TransactionPtrList TransactionList::toPtrList(bool subtransactions)
 {
+  if(subtransactions)
+    return AccountCursor(this).toPtrList();
   TransactionPtrList list;
-  for(int i = 0; i < size(); i++) {
-    if(subtransactions)
-      /// @todo Ugly const_cast
-      list.append(const_cast<Transaction &>(value(i)).allSubTransactions());
-    else
-      list << &(operator[](i));
-  }
+  for(int i = 0; i < size(); i++)
+    list << &(operator[](i));
   return list;
 }
 
@@ -203,6 +435,28 @@ void TransactionPtrList::sortByDate()
   qSort(rawData().begin(), rawData().end(), &compareTransactionsByDate);
 }
 
+TransactionVector TransactionPtrList::toVector() const
+{
+  TransactionVector rv;
+  rv.reserve(size());
+  for(int i = 0; i < size(); i++)
+    rv << at(i);
+  return rv;
+}
+
+void TransactionVector::sortByDate()
+{
+  qSort(begin(), end(), &compareTransactionsByDate);
+}
+
+TransactionPtrList TransactionVector::toPtrList() const
+{
+  TransactionPtrList rv;
+  for(int i = 0; i < size(); i++)
+    rv.append(at(i));
+  return rv;
+}
+
 void TransactionPtrList::append(const QList<Transaction *> & lst)
 {
   for(int i = 0; i < lst.size(); i++)
@@ -56,6 +56,14 @@ public:
   /// Adds the given Transaction to the statistics
   void addTransaction(const AtomicTransaction * t);
 
+  /// Accounts for @a weight transactions of the given amount. A
+  /// negative weight removes them. It does not touch firstMonthID.
+  void addAmount(int amount, int weight = 1);
+
+  /// Accounts for transactions of the @a n given amounts, using
+  /// sumAmounts(). It does not touch firstMonthID.
+  void addAmounts(const int * amounts, int n);
+
   /// Adds other stats to this one.
   BasicStatistics & operator+=(const BasicStatistics & stats);
 
@@ -77,6 +85,11 @@ public:
   /// Adds the given Transaction to the statistics
   void addTransaction(const AtomicTransaction * t);
 
+  using BasicStatistics::operator+=;
+
+  /// Merges statistics of another part of the list.
+  TransactionListStatistics & operator+=(const TransactionListStatistics & stats);
+
   /// Returns the BasicStatistics for this month
   inline const BasicStatistics & thisMonthStats() {
     return monthlyStats[Transaction::thisMonthID()];
@@ -92,8 +105,96 @@ public:
   int monthlyAverageAmount();
 };
 
+class TransactionPtrList;
+class TransactionVector;
+
+/// Daily prefix sums of a series of transactions, from which the
+/// statistics of any window of days can be obtained in constant time,
+/// see TransactionPtrList::dailyStatistics().
+class DailyStatistics {
+
+  /// Running totals, up to (but excluding) a given day.
+  class Prefix {
+  public:
+    int number = 0;
+    int numberCredit = 0;
+    int numberDebit = 0;
+    qint64 totalCredit = 0;
+    qint64 totalDebit = 0;
+  };
+
+  /// The first day
+  QDate firstDate;
+
+  /// Builds the prefix sums from any list of transaction pointers.
+  template <class L> void build(const L & lst);
+
+  /// prefixes[i] holds the totals of the days before firstDate + i,
+  /// so there is one more element than days.
+  QVector<Prefix> prefixes;
+
+  /// Returns the index in prefixes of the start of the day, clamped
+  /// to the valid range.
+  int dayIndex(const QDate & date) const;
+
+public:
+
+  /// Builds the prefix sums, in linear time. The transactions need
+  /// not be sorted.
+  DailyStatistics(const TransactionPtrList & lst);
+  DailyStatistics(const TransactionVector & lst);
+
+  /// The number of days covered
+  int days() const {
+    return std::max(prefixes.size() - 1, 0);
+  };
+
+  /// The statistics of the transactions between @a from and @a to,
+  /// both included.
+  BasicStatistics statistics(const QDate & from, const QDate & to) const;
+
+  /// The statistics of the @a days days up to @a end, included.
+  BasicStatistics lastDays(int days,
+                           const QDate & end = QDate::currentDate()) const {
+    return statistics(end.addDays(1 - days), end);
+  };
+
+  /// The total amount over the @a days days up to each day from
+  /// @a from to @a to, computed in a single pass. Suited to showing
+  /// rolling expenses over a long time.
+  QVector<int> rollingAmounts(int days, const QDate & from,
+                              const QDate & to) const;
+};
+
 class Period;
 
+/// A plain list of pointers to AtomicTransaction, for the results of
+/// read-only queries.
+///
+/// Contrary to TransactionPtrList, it is not Watchable: it neither
+/// allocates a Watchdog nor connects to the transactions it holds, so
+/// it is cheap to build and throw away. Use toPtrList() when the
+/// result is handed over to a view that must follow the changes of
+/// the transactions.
+class TransactionVector : public QVector<AtomicTransaction *> {
+public:
+
+  TransactionVector() {;};
+
+  /// Returns various interesting statistics about the list, see
+  /// TransactionPtrList::statistics().
+  TransactionListStatistics statistics() const;
+
+  /// Returns the daily statistics of the list.
+  DailyStatistics dailyStatistics() const;
+
+  /// Sorts the list according to the transaction date.
+  void sortByDate();
+
+  /// Returns an observing copy of the list.
+  TransactionPtrList toPtrList() const;
+};
+
 /// This class represents a list of Transaction objects, that can
 /// potentially be modified, but not stored unlike TransactionList. It
 /// is great for working on a sublist of a TransactionList.
@@ -105,9 +206,24 @@ class Period;
 class TransactionPtrList : public WatchablePtrList<AtomicTransaction> {
 public:
 
+  /// The smallest chunk into which statistics() splits a list.
+  /// Smaller chunks cost more in starting threads than they save, see
+  /// --benchmark-amounts.
+  static const int statisticsChunk = 20000;
+
   /// Returns various interesting statistics about the list.
+  ///
+  /// Large lists are split into chunks whose statistics are computed
+  /// in parallel and then merged.
   TransactionListStatistics statistics() const;
 
+  /// Returns the statistics of the elements from @a begin to
+  /// @a end (excluded), in the current thread.
+  TransactionListStatistics statistics(int begin, int end) const;
+
+  /// Returns the daily statistics of the list.
+  DailyStatistics dailyStatistics() const;
+
   /// The type for a function to work on TransactionPtrList
   typedef std::function<void (const TransactionPtrList &)> Action;
 
@@ -150,6 +266,9 @@ public:
   /// Returns the transactions in the given period
   TransactionPtrList transactionsForPeriod(const Period & period) const;
 
+  /// Returns a non-observing copy of the list.
+  TransactionVector toVector() const;
+
 };
 
 /// This class represents a list of Transaction objects, ready for
@@ -224,7 +224,7 @@ void TransactionListWidget::fireUpContextMenu(const QPoint & pos)
     else {
       action = new QAction(QObject::tr("Add subtransaction"));
       QObject::connect(action, &QAction::triggered, [t](bool) {
-          t->subTransactions.append(AtomicTransaction(0, t));
+          t->addSubTransaction();
         }
         );
     }
@@ -424,7 +424,7 @@ void TransactionListWidget::contextMenuActionFired(QAction * action)
                            tr("Enter subtransaction amount"));
     if(! amount)
       return;
-    t->subTransactions.append(AtomicTransaction(amount, t));
+    t->addSubTransaction(amount);
   } else if(what == "stats") { 
     TransactionListStatistics stats = selected.statistics();
     QString statsString = 
@@ -21,8 +21,10 @@
 #include <periodic.hh>
 
 #include <budget.hh>
+#include <transactioncursor.hh>
 
-Wallet::Wallet()
+Wallet::Wallet() : categorizationIndex(this), aggregates(this),
+                   textIndex(this)
 {
   watchChild(&accounts, "accounts");
   watchChild(&filters, "filters");
@@ -32,9 +34,10 @@ Wallet::Wallet()
 QList<Linkable *> Wallet::allTargets() const
 {
   QList<Linkable * > ret;
-  TransactionPtrList lst = allTransactions();
-  for(AtomicTransaction * t : lst)
-    ret << t;
+  for(int i = 0; i < accounts.size(); i++) {
+    for(AtomicTransaction * t : AccountCursor(&accounts.at(i)))
+      ret << t;
+  }
 
   for(const Budget & b: budgets) {
     for(const BudgetRealization & r : b.realizations) {
@@ -48,6 +51,7 @@ QList<Linkable *> Wallet::allTargets() const
 
 void Wallet::importAccountData(const OFXImport & data, bool runFilters)
 {
+  invalidateIndexes();
   for(int i = 0; i < data.accounts.size(); i++) {
     Account * ac = 0;
     int j = 0;
@@ -63,6 +67,8 @@ void Wallet::importAccountData(const OFXImport & data, bool runFilters)
     ac->wallet = this;		// Make sure the wallet attribute is
 				// set correctly
   }
+  // The filters may have run on temporary copies of the transactions
+  invalidateIndexes();
 }
 
 
@@ -80,11 +86,19 @@ SerializationAccessor * Wallet::serializationAccessor()
 
 void Wallet::clearContents()
 {
+  invalidateIndexes();
   accounts.clear();
   filters.clear();
   categories.clear();
 }
 
+void Wallet::invalidateIndexes()
+{
+  categorizationIndex.invalidate();
+  aggregates.invalidate();
+  textIndex.invalidate();
+}
+
 int Wallet::firstMonthID() const
 {
   int fm = -1;
@@ -111,6 +125,9 @@ void Wallet::prepareSerializationRead()
 void Wallet::finishedSerializationRead()
 {
   walletCurrentlyRead = NULL;
+  categories.renumber();
+  tags.ensureIDs();
+  invalidateIndexes();
   // Make sure that account.wallet points to here.
   for(int i = 0; i < accounts.size(); i++)
     accounts[i].wallet = this;
@@ -143,43 +160,65 @@ TransactionPtrList Wallet::transactionsForFilter(const Filter * filter)
 TransactionPtrList Wallet::categoryTransactions(const Category * category,
 						bool parents)
 {
-  TransactionPtrList vals;
-  for(int i = 0; i < accounts.size(); i++)
-    vals.append(accounts[i].categoryTransactions(category, parents));
-  return vals;
+  return categorizationIndex.categoryTransactions(category, parents).toPtrList();
 }
 
 TransactionPtrList Wallet::allTransactions() const
 {
   TransactionPtrList vals;
   for(int i = 0; i < accounts.size(); i++) {
-    Account * ac = const_cast<Account *>(&accounts[i]);
-    vals.append(ac->allTransactions());
+    for(AtomicTransaction * t : AccountCursor(&accounts.at(i)))
+      vals << t;
   }
   return vals;
 }
 
 TransactionPtrList Wallet::taggedTransactions(const Tag * tag)
 {
-  TransactionPtrList vals;
-  for(int i = 0; i < accounts.size(); i++)
-    vals.append(accounts[i].taggedTransactions(tag));
-  return vals;
+  return categorizationIndex.taggedTransactions(tag).toPtrList();
 }
 
-TransactionPtrList Wallet::transactionsForPeriod(const Period & period)
+TransactionPtrList Wallet::taggedTransactions(const TagSet & required,
+                                              const TagSet & excluded)
 {
-  TransactionPtrList list;
+  return categorizationIndex.taggedTransactions(required, excluded).toPtrList();
+}
+
+TransactionVector Wallet::transactionsForPeriod(const Period & period)
+{
+  TransactionVector list;
+  for(int j = 0; j < accounts.size(); j++)
+    list += accounts[j].transactionsForPeriod(period);
+  return list;
+}
+
+QList<TransactionVector> Wallet::transactionsForPeriods(const QList<Period> & periods)
+{
+  QList<TransactionVector> lists;
+  for(int k = 0; k < periods.size(); k++)
+    lists << TransactionVector();
+
+  QVector<int> firsts(periods.size()), lasts(periods.size());
   for(int j = 0; j < accounts.size(); j++) {
-    Account & account = accounts[j];
-    TransactionPtrList trs = account.allTransactions();
-    for(int i = 0; i < trs.size(); i++) {
-      AtomicTransaction * t = trs[i];
-      if(period.contains(t->getDate()))
-        list << t;
+    const Account & account = accounts.at(j);
+    bool sorted = true;
+    for(int k = 0; k < periods.size() && sorted; k++)
+      sorted = account.transactionRange(periods[k], &firsts[k], &lasts[k]);
+    if(sorted) {
+      for(int k = 0; k < periods.size(); k++)
+        for(AtomicTransaction * t : AccountCursor(&account, firsts[k], lasts[k]))
+          lists[k] << t;
+    }
+    else {
+      for(AtomicTransaction * t : AccountCursor(&account)) {
+        QDate date = t->getDate();
+        for(int k = 0; k < periods.size(); k++)
+          if(periods[k].contains(date))
+            lists[k] << t;
+      }
     }
   }
-  return list;
+  return lists;
 }
 
 Account * Wallet::namedAccount(const QString & name)
@@ -30,6 +30,9 @@
 #include <tag.hh>
 #include <watchablecontainers.hh>
 #include <budget.hh>
+#include <categorizationindex.hh>
+#include <aggregatecube.hh>
+#include <textindex.hh>
 
 class Budget;
 class Period;
@@ -68,6 +71,21 @@ public:
   /// Returns the list of all potential Link targets.
   QList<Linkable *> allTargets() const;
 
+  /// The index of the transactions by Category and Tag, used by
+  /// categoryTransactions() and taggedTransactions().
+  CategorizationIndex categorizationIndex;
+
+  /// Statistics by account, category, tag and month, kept up-to-date
+  /// as the transactions change.
+  AggregateCube aggregates;
+
+  /// The full-text index of the transactions
+  TransactionTextIndex textIndex;
+
+  /// Marks categorizationIndex, aggregates and textIndex as stale. To
+  /// be called whenever transactions are added or removed.
+  void invalidateIndexes();
+
 
   /// Runs the filters on the given transaction list
   void runFilters(TransactionList * list);
@@ -98,6 +116,12 @@ public:
   /// the transactions ancestry.
   TransactionPtrList taggedTransactions(const Tag * tag);
 
+  /// The list of Transaction objects that have all the tags in
+  /// @a required and none of the ones in @a excluded (such as
+  /// "tagged A and B but not C").
+  TransactionPtrList taggedTransactions(const TagSet & required,
+                                        const TagSet & excluded = TagSet());
+
   /// Returns all the transactions
   TransactionPtrList allTransactions() const;
 
@@ -141,7 +165,15 @@ public:
 public:
 
   /// Returns all the transactions within the given date range.
-  TransactionPtrList transactionsForPeriod(const Period & period);
+  TransactionVector transactionsForPeriod(const Period & period);
+
+  /// Returns the transactions within each of the given periods, in
+  /// the same order. Equivalent to calling transactionsForPeriod()
+  /// for each period, without the intermediate lists. Each period
+  /// costs a binary search in the date index of each account, except
+  /// for the accounts whose transactions are not sorted by date,
+  /// which are scanned once for all the periods.
+  QList<TransactionVector> transactionsForPeriods(const QList<Period> & periods);
 
   /// Returns the overall balance for all the accounts
   int balance(const QDate & date) const;
@@ -26,6 +26,7 @@
 #include <tagpage.hh>
 #include <budgetpage.hh>
 #include <cabinet.hh>
+#include <transactionlistdialog.hh>
 
 #include <htlabel.hh>
 #include <httarget-templates.hh>
@@ -37,6 +38,12 @@
 WalletDW::WalletDW(Cabinet * c) : wallet(&c->wallet), cabinet(c)
 {
   QVBoxLayout * layout = new QVBoxLayout(this);
+  searchField = new QLineEdit;
+  searchField->setPlaceholderText(tr("Search transactions: words, prefix*, \"phrase\""));
+  searchField->setClearButtonEnabled(true);
+  connect(searchField, SIGNAL(returnPressed()), SLOT(searchTransactions()));
+  layout->addWidget(searchField);
+
   summary = new HTLabel();
   layout->addWidget(summary);
   // LinksHandler::handleObject(summary);
@@ -72,6 +79,17 @@ void WalletDW::showBudgetsPage()
   NavigationWidget::gotoPage(BudgetPage::getBudgetPage(wallet));
 }
 
+void WalletDW::searchTransactions()
+{
+  QString query = searchField->text().trimmed();
+  if(query.isEmpty())
+    return;
+  TransactionVector trs = wallet->textIndex.search(query);
+  TransactionListDialog::showList(trs.toPtrList(),
+                                  tr("Transactions matching %1 (%2)").
+                                  arg(query).arg(trs.size()));
+}
+
 void WalletDW::updateSummary()
 {
   QString text = tr("<h2>Wallet</h2>");
@@ -41,6 +41,9 @@ class WalletDW : public DashboardWidget {
   /// The QLabel object displaying the rich text.
   HTLabel * summary;
 
+  /// The search field for the transactions
+  QLineEdit * searchField;
+
 public:
   WalletDW(Cabinet * c);
   virtual ~WalletDW();
@@ -69,6 +72,10 @@ public slots:
   /// Displays overall balance
   void displayBalance();
 
+  /// Shows the transactions matching the query of the search field,
+  /// see TransactionTextIndex.
+  void searchTransactions();
+
 protected:
   void showFiltersPage();
   void showCategoriesPage();
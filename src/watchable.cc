@@ -28,6 +28,9 @@
 ///
 /// @todo make something intersting with childChanged
 Watchdog::Watchdog() {
+#ifdef WATCHDOG_STATISTICS
+  created.ref();
+#endif
   connect(this, SIGNAL(attributeChanged(const Watchdog *, const QString &)),
           SIGNAL(changed(const Watchdog *)));
   connect(this, SIGNAL(numberChanged(const Watchdog *)),
@@ -37,6 +40,12 @@ Watchdog::Watchdog() {
 
 bool Watchdog::disableWatching = false;
 
+#ifdef WATCHDOG_STATISTICS
+QAtomicInt Watchdog::created;
+
+QAtomicInt Watchdog::childConnections;
+#endif
+
 void Watchdog::catchChange(const Watchdog * source)
 {
   if(disableWatching)
@@ -60,6 +69,9 @@ void Watchdog::watchChild(const Watchable* child,
   watchedChildren[child->watchDog()] = attrName;
   connect(child->watchDog(), SIGNAL(changed(const Watchdog *)),
           SLOT(catchChange(const Watchdog *)));
+#ifdef WATCHDOG_STATISTICS
+  childConnections.ref();
+#endif
 }
 
 void Watchdog::unwatchChild(const Watchable* child)
@@ -74,6 +74,15 @@ public:
   /// If set to true, disable the forwarding of signals. Used for
   /// loading.
   static bool disableWatching;
+
+#ifdef WATCHDOG_STATISTICS
+  /// The number of Watchdog objects created so far. Only used for
+  /// measurements, see the --query-connections command-line option.
+  static QAtomicInt created;
+
+  /// The number of connections made by watchChild() so far.
+  static QAtomicInt childConnections;
+#endif
 };
 
 /// This is the base class for all classes that emit signals when they